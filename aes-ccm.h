@@ -0,0 +1,81 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Software AES-128 and AES-CCM (RFC 3610) used to protect the
+ *         certificate flight fragments.
+ *
+ *         Two block cipher implementations are available and selected
+ *         at compile time with AES_CCM_CONF_TTABLE:
+ *
+ *         1 (default): 32-bit T-table rounds, about 4 KB of extra ROM.
+ *         0:           byte oriented S-box only rounds, for ROM
+ *                      constrained builds (make AES_COMPACT=1).
+ */
+
+#ifndef AES_CCM_H_
+#define AES_CCM_H_
+
+#include <stdint.h>
+
+#ifdef AES_CCM_CONF_TTABLE
+#define AES_CCM_TTABLE AES_CCM_CONF_TTABLE
+#else
+#define AES_CCM_TTABLE 1
+#endif
+
+#define AES_128_KEY_LEN   16
+#define AES_128_BLOCK_LEN 16
+
+/* CCM with a 13 byte nonce (L = 2) and an 8 byte MIC (M = 8). */
+#define AES_CCM_NONCE_LEN 13
+#define AES_CCM_MIC_LEN   8
+
+struct aes_128_ctx {
+  uint32_t rk[44];
+};
+
+void aes_128_set_key(struct aes_128_ctx *ctx, const uint8_t key[AES_128_KEY_LEN]);
+void aes_128_encrypt(const struct aes_128_ctx *ctx, uint8_t block[AES_128_BLOCK_LEN]);
+
+/* Encrypts data in place and writes the MIC to mic. */
+void aes_ccm_encrypt(const struct aes_128_ctx *ctx, const uint8_t *nonce,
+                     const uint8_t *adata, uint16_t adata_len,
+                     uint8_t *data, uint16_t data_len,
+                     uint8_t mic[AES_CCM_MIC_LEN]);
+
+/* Decrypts data in place. Returns 1 if the MIC matched, 0 otherwise. */
+int aes_ccm_decrypt(const struct aes_128_ctx *ctx, const uint8_t *nonce,
+                    const uint8_t *adata, uint16_t adata_len,
+                    uint8_t *data, uint16_t data_len,
+                    const uint8_t mic[AES_CCM_MIC_LEN]);
+
+/* Name of the compiled-in implementation, for benchmark output. */
+const char *aes_ccm_variant(void);
+
+#endif /* AES_CCM_H_ */
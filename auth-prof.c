@@ -0,0 +1,185 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Per-phase profiler for the authentication pipeline.
+ */
+
+#include "contiki.h"
+#include "sys/energest.h"
+#include "auth-prof.h"
+#include "ram-mon.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if AUTH_PROF_ENABLED
+
+/* Tmote Sky currents (uA) and supply voltage (mV) for the energy column. */
+#ifndef AUTH_PROF_CONF_CPU_UA
+#define AUTH_PROF_CONF_CPU_UA    1800
+#endif
+#ifndef AUTH_PROF_CONF_LPM_UA
+#define AUTH_PROF_CONF_LPM_UA    55
+#endif
+#ifndef AUTH_PROF_CONF_TX_UA
+#define AUTH_PROF_CONF_TX_UA     17700
+#endif
+#ifndef AUTH_PROF_CONF_LISTEN_UA
+#define AUTH_PROF_CONF_LISTEN_UA 20000
+#endif
+#ifndef AUTH_PROF_CONF_MV
+#define AUTH_PROF_CONF_MV        3000
+#endif
+
+struct phase_stats {
+  /* Snapshot taken by auth_prof_begin(). */
+  unsigned long start_energest[ENERGEST_TYPE_MAX];
+  rtimer_clock_t start_rtimer;
+  clock_time_t start_clock;
+  uint8_t active;
+
+  uint16_t count;
+  unsigned long min_ticks;
+  unsigned long max_ticks;
+  unsigned long sum_ticks;
+  unsigned long sum_energest[ENERGEST_TYPE_MAX];
+};
+
+static struct phase_stats stats[AUTH_PROF_PHASES];
+
+static const char *const phase_names[AUTH_PROF_PHASES] = {
+  "hash", "verify", "crypt", "keygen", "send", "wait", "flight"
+};
+/*---------------------------------------------------------------------------*/
+void
+auth_prof_begin(uint8_t phase)
+{
+  struct phase_stats *p;
+  int type;
+
+  if(phase >= AUTH_PROF_PHASES) {
+    return;
+  }
+  /* Before the snapshot, so the stack scan is not timed. */
+  ram_mon_phase_begin(phase);
+  p = &stats[phase];
+  energest_flush();
+  for(type = 0; type < ENERGEST_TYPE_MAX; type++) {
+    p->start_energest[type] = energest_type_time(type);
+  }
+  p->start_clock = clock_time();
+  p->start_rtimer = RTIMER_NOW();
+  p->active = 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+auth_prof_end(uint8_t phase)
+{
+  struct phase_stats *p;
+  unsigned long ticks;
+  clock_time_t clock_elapsed;
+  int type;
+
+  if(phase >= AUTH_PROF_PHASES || !stats[phase].active) {
+    return;
+  }
+  p = &stats[phase];
+  ticks = (rtimer_clock_t)(RTIMER_NOW() - p->start_rtimer);
+  clock_elapsed = clock_time() - p->start_clock;
+  /* A 16 bit rtimer wraps after two seconds on the sky; fall back to
+     the coarser clock for long phases such as key generation. */
+  if(clock_elapsed > CLOCK_SECOND) {
+    ticks = (unsigned long)clock_elapsed * (RTIMER_SECOND / CLOCK_SECOND);
+  }
+
+  energest_flush();
+  for(type = 0; type < ENERGEST_TYPE_MAX; type++) {
+    p->sum_energest[type] += energest_type_time(type) - p->start_energest[type];
+  }
+  if(p->count == 0 || ticks < p->min_ticks) {
+    p->min_ticks = ticks;
+  }
+  if(ticks > p->max_ticks) {
+    p->max_ticks = ticks;
+  }
+  p->sum_ticks += ticks;
+  p->count++;
+  p->active = 0;
+  ram_mon_phase_end(phase);
+}
+/*---------------------------------------------------------------------------*/
+const char *
+auth_prof_phase_name(uint8_t phase)
+{
+  return phase < AUTH_PROF_PHASES ? phase_names[phase] : "?";
+}
+/*---------------------------------------------------------------------------*/
+void
+auth_prof_reset(void)
+{
+  memset(stats, 0, sizeof(stats));
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+energy_uj(const struct phase_stats *p)
+{
+  unsigned long long charge;
+
+  /* uA * ticks summed over the power states, then scaled to uJ. */
+  charge = (unsigned long long)p->sum_energest[ENERGEST_TYPE_CPU] * AUTH_PROF_CONF_CPU_UA +
+           (unsigned long long)p->sum_energest[ENERGEST_TYPE_LPM] * AUTH_PROF_CONF_LPM_UA +
+           (unsigned long long)p->sum_energest[ENERGEST_TYPE_TRANSMIT] * AUTH_PROF_CONF_TX_UA +
+           (unsigned long long)p->sum_energest[ENERGEST_TYPE_LISTEN] * AUTH_PROF_CONF_LISTEN_UA;
+  return (unsigned long)(charge * AUTH_PROF_CONF_MV / 1000 / RTIMER_SECOND / p->count);
+}
+/*---------------------------------------------------------------------------*/
+void
+auth_prof_dump(void)
+{
+  const struct phase_stats *p;
+  int i;
+
+  /* Times in rtimer ticks, energest columns are per-call averages. */
+  printf("prof phase n min avg max cpu lpm tx listen uJ\n");
+  for(i = 0; i < AUTH_PROF_PHASES; i++) {
+    p = &stats[i];
+    if(p->count == 0) {
+      continue;
+    }
+    printf("prof %s %u %lu %lu %lu %lu %lu %lu %lu %lu\n", phase_names[i],
+           p->count, p->min_ticks, p->sum_ticks / p->count, p->max_ticks,
+           p->sum_energest[ENERGEST_TYPE_CPU] / p->count,
+           p->sum_energest[ENERGEST_TYPE_LPM] / p->count,
+           p->sum_energest[ENERGEST_TYPE_TRANSMIT] / p->count,
+           p->sum_energest[ENERGEST_TYPE_LISTEN] / p->count,
+           energy_uj(p));
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* AUTH_PROF_ENABLED */
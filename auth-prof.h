@@ -0,0 +1,71 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Per-phase profiler for the authentication pipeline. Each
+ *         auth_prof_begin()/auth_prof_end() pair snapshots every energest
+ *         type and the elapsed time; min/avg/max are kept per phase over
+ *         all sessions and printed by the "prof" serial command.
+ */
+
+#ifndef AUTH_PROF_H_
+#define AUTH_PROF_H_
+
+#include "contiki.h"
+
+#ifdef AUTH_PROF_CONF_ENABLED
+#define AUTH_PROF_ENABLED AUTH_PROF_CONF_ENABLED
+#else
+#define AUTH_PROF_ENABLED 1
+#endif
+
+enum {
+  AUTH_PROF_HASH,     /* certificate hashing */
+  AUTH_PROF_VERIFY,   /* signature verification */
+  AUTH_PROF_CRYPT,    /* fragment encryption and decryption */
+  AUTH_PROF_KEYGEN,   /* key generation */
+  AUTH_PROF_SEND,     /* building and queueing a fragment */
+  AUTH_PROF_WAIT,     /* waiting for the peer, radio listen/TX */
+  AUTH_PROF_FLIGHT,   /* one whole certificate flight */
+  AUTH_PROF_PHASES
+};
+
+#if AUTH_PROF_ENABLED
+void auth_prof_begin(uint8_t phase);
+void auth_prof_end(uint8_t phase);
+void auth_prof_reset(void);
+void auth_prof_dump(void);
+const char *auth_prof_phase_name(uint8_t phase);
+#else /* AUTH_PROF_ENABLED */
+#define auth_prof_begin(phase)
+#define auth_prof_end(phase)
+#define auth_prof_reset()
+#define auth_prof_dump()
+#endif /* AUTH_PROF_ENABLED */
+
+#endif /* AUTH_PROF_H_ */
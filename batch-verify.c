@@ -0,0 +1,297 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Batch signature verification.
+ */
+
+#include "contiki.h"
+#include "batch-verify.h"
+#include "cert-crypto.h"
+#include "sha256-mb.h"
+#include "ram-mon.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static struct batch_verify_item queue[BATCH_VERIFY_MAX];
+static uint16_t queue_len;
+RAM_POOL(queue_pool, "verify queue", BATCH_VERIFY_MAX,
+         sizeof(struct batch_verify_item));
+static struct ctimer window_timer;
+static batch_verify_callback_t verify_done;
+static uint8_t flushing;
+
+#ifndef BATCH_VERIFY_CONF_BACKEND
+/*---------------------------------------------------------------------------*/
+/*
+ * Stand-in backend: the tree has no real signature scheme yet. It keeps
+ * the cost shape of a batch verifier such as Ed25519 with a multi-scalar
+ * multiplication: one expensive check per batch on top of the per item
+ * certificate hashes.
+ */
+static int
+standin_verify(const struct batch_verify_item *items, uint16_t n)
+{
+  singnature_varification();
+  return 1;
+}
+
+static const struct batch_verify_backend standin_backend = {
+  "stand-in", standin_verify
+};
+
+static const struct batch_verify_backend *backend = &standin_backend;
+#else /* BATCH_VERIFY_CONF_BACKEND */
+extern const struct batch_verify_backend BATCH_VERIFY_CONF_BACKEND;
+static const struct batch_verify_backend *backend = &BATCH_VERIFY_CONF_BACKEND;
+#endif /* BATCH_VERIFY_CONF_BACKEND */
+
+/* Self test: certificates starting with this byte are rejected. */
+#define SELFTEST_BAD 0xff
+#define SELFTEST_ITEMS 16
+static uint16_t selftest_calls;
+static uint8_t selftest_verdict[SELFTEST_ITEMS];
+/*---------------------------------------------------------------------------*/
+static void
+report(uint16_t start, uint16_t n, int ok)
+{
+  uint16_t i;
+
+  for(i = start; i < start + n; i++) {
+    if(queue[i].owner != NULL && verify_done != NULL) {
+      verify_done(queue[i].owner, ok);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_certificates(uint16_t n)
+{
+  const uint8_t *msgs[SHA256_MB_MAX_LANES];
+  size_t lens[SHA256_MB_MAX_LANES];
+  uint8_t digests[SHA256_MB_MAX_LANES][SHA256_BLOCK_SIZE];
+  uint16_t i, j, group;
+
+  /* Sessions that finished together are hashed side by side. */
+  for(i = 0; i < n; i += group) {
+    group = n - i < SHA256_MB_MAX_LANES ? n - i : SHA256_MB_MAX_LANES;
+    for(j = 0; j < group; j++) {
+      msgs[j] = queue[i + j].cert;
+      lens[j] = queue[i + j].cert_len;
+    }
+    sha256_mb(msgs, lens, digests, group);
+    for(j = 0; j < group; j++) {
+      memcpy(queue[i + j].digest, digests[j], SHA256_BLOCK_SIZE);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+verify_range(uint16_t start, uint16_t n)
+{
+  if(backend->verify(&queue[start], n)) {
+    report(start, n, 1);
+  } else if(n == 1) {
+    report(start, n, 0);
+  } else {
+    /* Somebody in here is bad: bisect to find out who. */
+    verify_range(start, n / 2);
+    verify_range(start + n / 2, n - n / 2);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_expired(void *ptr)
+{
+  batch_verify_flush();
+}
+/*---------------------------------------------------------------------------*/
+void
+batch_verify_init(batch_verify_callback_t done)
+{
+  verify_done = done;
+  queue_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+batch_verify_submit(void *owner, const uint8_t *cert, uint16_t cert_len)
+{
+  if(queue_len >= BATCH_VERIFY_MAX || cert_len > BATCH_VERIFY_CERT_MAX) {
+    return 0;
+  }
+  queue[queue_len].owner = owner;
+  queue[queue_len].cert_len = cert_len;
+  memcpy(queue[queue_len].cert, cert, cert_len);
+  if(queue_len++ == 0) {
+    ctimer_set(&window_timer, BATCH_VERIFY_WINDOW, window_expired, NULL);
+  }
+  ram_pool_set(&queue_pool, queue_len);
+  if(queue_len == BATCH_VERIFY_MAX && !flushing) {
+    batch_verify_flush();
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+batch_verify_cancel(void *owner)
+{
+  uint16_t i;
+
+  for(i = 0; i < queue_len; i++) {
+    if(queue[i].owner == owner) {
+      queue[i].owner = NULL;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+batch_verify_flush(void)
+{
+  uint16_t n;
+
+  ctimer_stop(&window_timer);
+  n = queue_len;
+  if(n == 0) {
+    return;
+  }
+  flushing = 1;
+  hash_certificates(n);
+  verify_range(0, n);
+  flushing = 0;
+  /* Callbacks may have queued new checks behind the verified ones. */
+  memmove(&queue[0], &queue[n], (queue_len - n) * sizeof(queue[0]));
+  queue_len -= n;
+  ram_pool_set(&queue_pool, queue_len);
+  if(queue_len > 0) {
+    ctimer_set(&window_timer, BATCH_VERIFY_WINDOW, window_expired, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+selftest_verify(const struct batch_verify_item *items, uint16_t n)
+{
+  uint16_t i;
+
+  selftest_calls++;
+  for(i = 0; i < n; i++) {
+    if(items[i].cert[0] == SELFTEST_BAD) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+selftest_done(void *owner, int ok)
+{
+  selftest_verdict[(uint8_t *)owner - selftest_verdict] = ok;
+}
+/*---------------------------------------------------------------------------*/
+/* Two bad certificates among SELFTEST_ITEMS must be singled out, the
+   rest accepted. */
+static void
+selftest(void)
+{
+  static const struct batch_verify_backend selftest_backend = {
+    "self test", selftest_verify
+  };
+  const struct batch_verify_backend *saved_backend;
+  batch_verify_callback_t saved_done;
+  uint8_t cert[4];
+  uint16_t n, i;
+  int ok;
+
+  n = SELFTEST_ITEMS < BATCH_VERIFY_MAX ? SELFTEST_ITEMS : BATCH_VERIFY_MAX;
+  saved_backend = backend;
+  saved_done = verify_done;
+  backend = &selftest_backend;
+  verify_done = selftest_done;
+  selftest_calls = 0;
+  memset(selftest_verdict, 2, sizeof(selftest_verdict));
+  for(i = 0; i < n; i++) {
+    memset(cert, 'A', sizeof(cert));
+    if(i == 1 || i == n - 2) {
+      cert[0] = SELFTEST_BAD;
+    }
+    batch_verify_submit(&selftest_verdict[i], cert, sizeof(cert));
+  }
+  batch_verify_flush();
+  ok = 1;
+  for(i = 0; i < n; i++) {
+    if(selftest_verdict[i] != (i == 1 || i == n - 2 ? 0 : 1)) {
+      ok = 0;
+    }
+  }
+  printf("batch-verify bisection self test [%u] items [%u] backend calls %s\n",
+         n, selftest_calls, ok ? "ok" : "FAILED");
+  backend = saved_backend;
+  verify_done = saved_done;
+}
+/*---------------------------------------------------------------------------*/
+void
+batch_verify_benchmark(void)
+{
+  static const uint16_t sizes[] = { 1, 8, 64, 256 };
+  /* Verifications per size, so every size does the same total work. */
+  const uint16_t total = 256;
+  batch_verify_callback_t saved_done;
+  clock_time_t start, elapsed;
+  uint16_t i, done;
+  uint16_t n;
+
+  selftest();
+  saved_done = verify_done;
+  verify_done = NULL;
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    n = sizes[i];
+    if(n > BATCH_VERIFY_MAX) {
+      printf("batch-verify [%s] size [%u] skipped, BATCH_VERIFY_MAX [%u]\n",
+             backend->name, n, BATCH_VERIFY_MAX);
+      continue;
+    }
+    start = clock_time();
+    for(done = 0; done < total; done += n) {
+      queue_len = 0;
+      while(queue_len < n) {
+        memset(queue[queue_len].cert, 'A', BATCH_VERIFY_CERT_MAX);
+        queue[queue_len].cert_len = BATCH_VERIFY_CERT_MAX;
+        queue[queue_len++].owner = NULL;
+      }
+      batch_verify_flush();
+    }
+    elapsed = clock_time() - start;
+    if(elapsed == 0) {
+      elapsed = 1;
+    }
+    printf("batch-verify [%s] size [%u] [%lu] verif/s\n", backend->name, n,
+           (unsigned long)total * CLOCK_SECOND / elapsed);
+  }
+  verify_done = saved_done;
+}
+/*---------------------------------------------------------------------------*/
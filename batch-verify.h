@@ -0,0 +1,105 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Batch signature verification. Pending certificate checks from
+ *         many sessions are collected for a short window and handed to
+ *         the backend as one batch; a failing batch is bisected so every
+ *         session still gets its own verdict.
+ */
+
+#ifndef BATCH_VERIFY_H_
+#define BATCH_VERIFY_H_
+
+#include "contiki.h"
+#include "sha256.h"
+
+/* Off until a real verifier replaces the stand-in backend, which
+   accepts every certificate. */
+#ifdef BATCH_VERIFY_CONF_ENABLED
+#define BATCH_VERIFY_ENABLED BATCH_VERIFY_CONF_ENABLED
+#else
+#define BATCH_VERIFY_ENABLED 0
+#endif
+
+#ifdef BATCH_VERIFY_CONF_MAX
+#define BATCH_VERIFY_MAX BATCH_VERIFY_CONF_MAX
+#elif CONTIKI_TARGET_NATIVE
+#define BATCH_VERIFY_MAX 256
+#else
+#define BATCH_VERIFY_MAX 8
+#endif
+
+/* How long the first pending check waits for others to join. */
+#ifdef BATCH_VERIFY_CONF_WINDOW
+#define BATCH_VERIFY_WINDOW BATCH_VERIFY_CONF_WINDOW
+#else
+#define BATCH_VERIFY_WINDOW (CLOCK_SECOND / 20)
+#endif
+
+/* Bytes of certificate data kept per pending check. */
+#ifdef BATCH_VERIFY_CONF_CERT_MAX
+#define BATCH_VERIFY_CERT_MAX BATCH_VERIFY_CONF_CERT_MAX
+#else
+#define BATCH_VERIFY_CERT_MAX 128
+#endif
+
+struct batch_verify_item {
+  void *owner;
+  uint16_t cert_len;
+  uint8_t cert[BATCH_VERIFY_CERT_MAX];
+  /* Filled in for the whole batch at once before the backend runs. */
+  uint8_t digest[SHA256_BLOCK_SIZE];
+};
+
+struct batch_verify_backend {
+  const char *name;
+  /* Returns 1 only if every one of the n items verifies. */
+  int (*verify)(const struct batch_verify_item *items, uint16_t n);
+};
+
+typedef void (*batch_verify_callback_t)(void *owner, int ok);
+
+void batch_verify_init(batch_verify_callback_t done);
+
+/* Queues a check of cert. Returns 0 if the queue is full or the
+   certificate is longer than BATCH_VERIFY_CERT_MAX. */
+int batch_verify_submit(void *owner, const uint8_t *cert, uint16_t cert_len);
+
+/* Drops the pending check of owner, its callback will not be called. */
+void batch_verify_cancel(void *owner);
+
+/* Verifies everything pending now instead of waiting for the window. */
+void batch_verify_flush(void);
+
+/* Prints verifications/s at batch sizes 1, 8, 64 and 256, after a self
+   test of the bisection against a backend that rejects marked items.
+   Uses the queue, so run it before any session submits a check. */
+void batch_verify_benchmark(void);
+
+#endif /* BATCH_VERIFY_H_ */
@@ -0,0 +1,328 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Admission control for new flights on the provider.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/ip/uip.h"
+#include "net/ip/uip-udp-packet.h"
+#include "cert-admit.h"
+#include "cert-crypto.h"
+#include "replay-window.h"
+#include "scratch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if CERT_ADMIT_ENABLED
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+#define MSG_BUSY 'B'
+#define BUSY_LEN 3
+
+struct waiter {
+  uip_ipaddr_t addr;
+  /* When it was told to wait, and for how long. */
+  clock_time_t stamp;
+  clock_time_t wait;
+};
+
+static struct uip_udp_conn *conn;
+static uint8_t is_client;
+
+/* Provider. */
+static struct waiter queue[CERT_ADMIT_QUEUE];
+static uint8_t queue_len, queue_peak;
+static uint8_t tokens;
+static clock_time_t refill_stamp;
+static unsigned long admitted, turned_away, queue_full, expired;
+
+/* Client. */
+static struct ctimer backoff_timer;
+static void (*retry_fn)(void);
+static uint8_t flight_busy;
+static unsigned long flight_backoff;
+static unsigned long busy_total, flights_delayed, backoff_total;
+
+/*---------------------------------------------------------------------------*/
+static void
+refill(void)
+{
+  clock_time_t now;
+
+  now = clock_time();
+  while(tokens < CERT_ADMIT_BURST &&
+        now - refill_stamp >= CERT_ADMIT_INTERVAL) {
+    tokens++;
+    refill_stamp += CERT_ADMIT_INTERVAL;
+  }
+  if(tokens == CERT_ADMIT_BURST) {
+    /* A full bucket does not save up; the next token is an interval
+       after the first one taken. */
+    refill_stamp = now;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_remove(int i)
+{
+  queue_len--;
+  memmove(&queue[i], &queue[i + 1], (queue_len - i) * sizeof(queue[0]));
+}
+/*---------------------------------------------------------------------------*/
+/* Drops waiters that did not come back within their delay, its jitter
+   and two more intervals. */
+static void
+queue_expire(void)
+{
+  int i;
+
+  for(i = 0; i < queue_len;) {
+    if(clock_time() - queue[i].stamp >
+       queue[i].wait + queue[i].wait / 2 + 2 * CERT_ADMIT_INTERVAL) {
+      queue_remove(i);
+      expired++;
+    } else {
+      i++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+queue_find(const uip_ipaddr_t *addr)
+{
+  int i;
+
+  for(i = 0; i < queue_len; i++) {
+    if(uip_ipaddr_cmp(&queue[i].addr, addr)) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+/* Until the token of the waiter at pos, counting those in front of it. */
+static clock_time_t
+wait_for(int pos, int slot_free)
+{
+  clock_time_t elapsed;
+  clock_time_t wait;
+
+  wait = 0;
+  if(pos >= tokens) {
+    elapsed = clock_time() - refill_stamp;
+    if(elapsed > CERT_ADMIT_INTERVAL) {
+      elapsed = CERT_ADMIT_INTERVAL;
+    }
+    wait = CERT_ADMIT_INTERVAL - elapsed +
+      (pos - tokens) * CERT_ADMIT_INTERVAL;
+  }
+  /* Slots free up as flights end, at no particular time. */
+  if(!slot_free && wait < CERT_ADMIT_INTERVAL) {
+    wait = CERT_ADMIT_INTERVAL;
+  }
+  if(wait < CERT_ADMIT_INTERVAL / 4) {
+    wait = CERT_ADMIT_INTERVAL / 4;
+  }
+  return wait;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_busy(const uip_ipaddr_t *to, clock_time_t wait)
+{
+  scratch_mark_t mark;
+  uint8_t *buf;
+  unsigned long ms;
+  uint16_t len;
+
+  ms = (unsigned long)wait * 1000 / CLOCK_SECOND;
+  if(ms > 0xffff) {
+    ms = 0xffff;
+  }
+  mark = scratch_mark();
+  buf = scratch_alloc(BUSY_LEN + CERT_CRYPTO_OVERHEAD);
+  if(buf != NULL) {
+    buf[CERT_CRYPTO_HDR_LEN] = MSG_BUSY;
+    buf[CERT_CRYPTO_HDR_LEN + 1] = ms >> 8;
+    buf[CERT_CRYPTO_HDR_LEN + 2] = ms & 0xff;
+    len = cert_crypto_seal(buf, BUSY_LEN);
+    if(len != 0) {
+      uip_udp_packet_sendto(conn, buf, len, to,
+                            UIP_HTONS(CERT_ADMIT_CLIENT_PORT));
+    }
+  }
+  scratch_release(mark);
+  turned_away++;
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_admit_provider_init(void)
+{
+  tokens = CERT_ADMIT_BURST;
+  refill_stamp = clock_time();
+  conn = udp_new(NULL, 0, NULL);
+  udp_bind(conn, UIP_HTONS(CERT_ADMIT_PROVIDER_PORT));
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_admit_client_init(void)
+{
+  is_client = 1;
+  conn = udp_new(NULL, 0, NULL);
+  udp_bind(conn, UIP_HTONS(CERT_ADMIT_CLIENT_PORT));
+}
+/*---------------------------------------------------------------------------*/
+struct uip_udp_conn *
+cert_admit_conn(void)
+{
+  return conn;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_admit_request(const uip_ipaddr_t *peer, int slot_free)
+{
+  int pos;
+
+  refill();
+  queue_expire();
+  pos = queue_find(peer);
+  /* Everyone queued in front has a token promised. */
+  if(slot_free && (pos < 0 ? queue_len : pos) < tokens) {
+    tokens--;
+    if(pos >= 0) {
+      queue_remove(pos);
+    }
+    admitted++;
+    return 1;
+  }
+  if(pos < 0) {
+    if(queue_len == CERT_ADMIT_QUEUE) {
+      queue_full++;
+      send_busy(peer, (CERT_ADMIT_QUEUE + 1) * CERT_ADMIT_INTERVAL);
+      return 0;
+    }
+    pos = queue_len++;
+    uip_ipaddr_copy(&queue[pos].addr, peer);
+    if(queue_len > queue_peak) {
+      queue_peak = queue_len;
+    }
+  }
+  queue[pos].stamp = clock_time();
+  queue[pos].wait = wait_for(pos, slot_free);
+  send_busy(peer, queue[pos].wait);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+cert_admit_input(const uip_ipaddr_t *provider)
+{
+  uint8_t *plain;
+  uint16_t delay;
+
+  if(!uip_newdata() || !is_client ||
+     !uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, provider) ||
+     uip_datalen() < CERT_CRYPTO_HDR_LEN) {
+    return 0;
+  }
+  plain = (uint8_t *)uip_appdata;
+#if REPLAY_WINDOW_ENABLED
+  /* A recorded BUSY must not keep the client backing off. */
+  if(!replay_window_check(CERT_CRYPTO_SENDER(plain),
+                          CERT_CRYPTO_COUNTER(plain))) {
+    return 0;
+  }
+#endif /* REPLAY_WINDOW_ENABLED */
+  if(cert_crypto_open(plain, uip_datalen()) != BUSY_LEN) {
+    return 0;
+  }
+#if REPLAY_WINDOW_ENABLED
+  replay_window_update(CERT_CRYPTO_SENDER(plain), CERT_CRYPTO_COUNTER(plain));
+#endif /* REPLAY_WINDOW_ENABLED */
+  plain += CERT_CRYPTO_HDR_LEN;
+  if(plain[0] != MSG_BUSY) {
+    return 0;
+  }
+  delay = (plain[1] << 8) | plain[2];
+  return delay > 0 ? delay : 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+backoff_timeout(void *ptr)
+{
+  retry_fn();
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_admit_backoff(uint16_t delay, void (*retry)(void))
+{
+  unsigned long ms;
+
+  /* Clients told the same delay should not all return at once. */
+  ms = delay + random_rand() % (delay / 2 + 1);
+  flight_busy++;
+  flight_backoff += ms;
+  busy_total++;
+  retry_fn = retry;
+  printf("admit: provider busy, retrying in [%lu] ms\n", ms);
+  ctimer_set(&backoff_timer, ms * CLOCK_SECOND / 1000 + 1,
+             backoff_timeout, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_admit_done(void)
+{
+  if(flight_busy == 0) {
+    return;
+  }
+  printf("admit: in after [%u] busy, [%lu] ms backoff\n",
+         flight_busy, flight_backoff);
+  flights_delayed++;
+  backoff_total += flight_backoff;
+  flight_busy = 0;
+  flight_backoff = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_admit_stats(void)
+{
+  if(is_client) {
+    printf("admit: [%lu] busy [%lu] flights delayed [%lu] ms backoff\n",
+           busy_total, flights_delayed, backoff_total);
+    return;
+  }
+  refill();
+  printf("admit: [%lu] admitted [%lu] busy [%lu] queue full [%lu] expired, queue [%u/%u] peak [%u] tokens [%u/%u]\n",
+         admitted, turned_away, queue_full, expired,
+         queue_len, CERT_ADMIT_QUEUE, queue_peak, tokens, CERT_ADMIT_BURST);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* CERT_ADMIT_ENABLED */
@@ -0,0 +1,117 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Admission control for new flights on the provider. After a
+ *         network-wide reboot every client starts its flight at about
+ *         the same time; instead of taking them all on and evicting
+ *         sessions half way through, the provider admits new sessions
+ *         from a token bucket (CERT_ADMIT_BURST tokens, one more every
+ *         CERT_ADMIT_INTERVAL) and only while a session slot is free.
+ *
+ *         A client that is turned away is put on a bounded FIFO and
+ *         told when to come back:
+ *
+ *           BUSY ['B'][retry after ms (2)]
+ *
+ *         sealed like every other message and sent to the client's
+ *         CERT_ADMIT_CLIENT_PORT. The delay covers the tokens promised
+ *         to the clients queued in front of it, so a newcomer is only
+ *         let in ahead of the queue when there are tokens to spare. A
+ *         queued client that does not come back in time loses its place.
+ *         The client retries after the delay plus random jitter of up to
+ *         half of it.
+ */
+
+#ifndef CERT_ADMIT_H_
+#define CERT_ADMIT_H_
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+
+#ifdef CERT_ADMIT_CONF_ENABLED
+#define CERT_ADMIT_ENABLED CERT_ADMIT_CONF_ENABLED
+#else
+#define CERT_ADMIT_ENABLED 0
+#endif
+
+/* Sessions that may start back to back. */
+#ifdef CERT_ADMIT_CONF_BURST
+#define CERT_ADMIT_BURST CERT_ADMIT_CONF_BURST
+#else
+#define CERT_ADMIT_BURST 2
+#endif
+
+/* One more new session per interval after that. */
+#ifdef CERT_ADMIT_CONF_INTERVAL
+#define CERT_ADMIT_INTERVAL CERT_ADMIT_CONF_INTERVAL
+#else
+#define CERT_ADMIT_INTERVAL (CLOCK_SECOND * 2)
+#endif
+
+/* Clients waiting for a token; a full queue gets the longest delay. */
+#ifdef CERT_ADMIT_CONF_QUEUE
+#define CERT_ADMIT_QUEUE CERT_ADMIT_CONF_QUEUE
+#else
+#define CERT_ADMIT_QUEUE 8
+#endif
+
+/* A session this quiet no longer holds its slot against new ones. */
+#ifdef CERT_ADMIT_CONF_IDLE
+#define CERT_ADMIT_IDLE CERT_ADMIT_CONF_IDLE
+#else
+#define CERT_ADMIT_IDLE (CLOCK_SECOND * 10)
+#endif
+
+#define CERT_ADMIT_CLIENT_PORT   8778
+#define CERT_ADMIT_PROVIDER_PORT 5693
+
+/* Call from the provider and the client process respectively. */
+void cert_admit_provider_init(void);
+void cert_admit_client_init(void);
+
+struct uip_udp_conn *cert_admit_conn(void);
+
+/* Provider: 1 if peer may start a flight now, otherwise it has been sent
+   a BUSY. slot_free is 1 if a session slot is available. */
+int cert_admit_request(const uip_ipaddr_t *peer, int slot_free);
+
+/* Client: tcpip_event on the connection above. Returns the retry delay
+   of a BUSY from provider in ms, 0 for anything else, replays included. */
+uint16_t cert_admit_input(const uip_ipaddr_t *provider);
+
+/* Client: calls retry after delay ms plus jitter. */
+void cert_admit_backoff(uint16_t delay, void (*retry)(void));
+
+/* Client: the flight got its first reply, reports the backoff it took. */
+void cert_admit_done(void);
+
+/* Admitted, turned away, queue and backoff counters on one line. */
+void cert_admit_stats(void);
+
+#endif /* CERT_ADMIT_H_ */
@@ -0,0 +1,607 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         In-network certificate cache.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ip/uip-udp-packet.h"
+#include "net/rpl/rpl.h"
+#include "cert-cache.h"
+#include "cert-crypto.h"
+#include "ram-mon.h"
+#include "scratch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if CERT_CACHE_ENABLED
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+#define MSG_REQUEST  'Q'
+#define MSG_FRAGMENT 'F'
+#define REQUEST_LEN       (1 + SHA256_BLOCK_SIZE + 1)
+#define FRAGMENT_HDR_LEN  (1 + SHA256_BLOCK_SIZE + 2)
+#define MAX_MSG_LEN       (FRAGMENT_HDR_LEN + CERT_CACHE_FRAGMENT_LEN)
+
+/* Pending requests are matched on a digest prefix. */
+#define KEY_LEN 8
+
+/* Fragments of the stand-in chain, as in the flight. */
+#define CHAIN_FRAGMENTS 18
+
+/* Arrival is tracked in a 32 bit mask. */
+#define MAX_FRAGMENTS 32
+
+#define FETCH_TRIES 3
+
+#define ENTRY_FREE    0
+#define ENTRY_FILLING 1
+#define ENTRY_VALID   2
+
+struct entry {
+  uint8_t digest[SHA256_BLOCK_SIZE];
+  uint32_t have;
+  clock_time_t used;
+  uint16_t len;
+  uint8_t count;
+  uint8_t state;
+  uint8_t data[CERT_CACHE_ENTRY_SIZE];
+};
+
+struct pending {
+  uip_ipaddr_t child;
+  clock_time_t since;
+  uint8_t key[KEY_LEN];
+  uint8_t index;
+  uint8_t used;
+};
+
+static struct entry entries[CERT_CACHE_ENTRIES];
+RAM_POOL(entry_pool, "cache entries", CERT_CACHE_ENTRIES, sizeof(struct entry));
+static struct pending pending[CERT_CACHE_PENDING];
+
+static struct {
+  uint8_t digest[SHA256_BLOCK_SIZE];
+  uip_ipaddr_t origin;
+  SHA256_CTX ctx;
+  cert_cache_fragment_cb fragment;
+  cert_cache_done_cb done;
+  uint8_t index;
+  uint8_t tries;
+  uint8_t direct;
+  uint8_t active;
+  uint8_t ok;
+} fetch;
+static struct ctimer fetch_timer;
+
+static struct uip_udp_conn *conn;
+static uint8_t own_digest[SHA256_BLOCK_SIZE];
+static uint8_t own_count;
+
+static unsigned long hits, misses, merged, bytes;
+
+/*---------------------------------------------------------------------------*/
+static uint8_t
+fragment_count(void)
+{
+#if CERT_CBOR_ENABLED
+  return cert_fragment_count(CERT_CACHE_FRAGMENT_LEN);
+#else /* CERT_CBOR_ENABLED */
+  return CHAIN_FRAGMENTS;
+#endif /* CERT_CBOR_ENABLED */
+}
+/*---------------------------------------------------------------------------*/
+static void
+send(uint8_t *buf, uint16_t len, const uip_ipaddr_t *to)
+{
+  len = cert_crypto_seal(buf, len);
+  if(len == 0) {
+    return;
+  }
+  uip_udp_packet_sendto(conn, buf, len, to, UIP_HTONS(CERT_CACHE_PORT));
+  bytes += len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_request(const uip_ipaddr_t *to, const uint8_t *digest, uint8_t index)
+{
+  scratch_mark_t mark;
+  uint8_t *buf;
+
+  mark = scratch_mark();
+  buf = scratch_alloc(REQUEST_LEN + CERT_CRYPTO_OVERHEAD);
+  if(buf != NULL) {
+    buf[CERT_CRYPTO_HDR_LEN] = MSG_REQUEST;
+    memcpy(buf + CERT_CRYPTO_HDR_LEN + 1, digest, SHA256_BLOCK_SIZE);
+    buf[CERT_CRYPTO_HDR_LEN + 1 + SHA256_BLOCK_SIZE] = index;
+    send(buf, REQUEST_LEN, to);
+  }
+  scratch_release(mark);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_fragment(const uip_ipaddr_t *to, const uint8_t *digest, uint8_t index,
+              uint8_t count, const uint8_t *data, uint16_t len)
+{
+  scratch_mark_t mark;
+  uint8_t *buf;
+  uint8_t *p;
+
+  mark = scratch_mark();
+  buf = scratch_alloc(MAX_MSG_LEN + CERT_CRYPTO_OVERHEAD);
+  if(buf != NULL) {
+    p = buf + CERT_CRYPTO_HDR_LEN;
+    p[0] = MSG_FRAGMENT;
+    memcpy(p + 1, digest, SHA256_BLOCK_SIZE);
+    p[1 + SHA256_BLOCK_SIZE] = index;
+    p[2 + SHA256_BLOCK_SIZE] = count;
+    if(data != NULL) {
+      memcpy(p + FRAGMENT_HDR_LEN, data, len);
+    } else {
+      len = cert_fragment_load(index, p + FRAGMENT_HDR_LEN,
+                               CERT_CACHE_FRAGMENT_LEN);
+    }
+    send(buf, FRAGMENT_HDR_LEN + len, to);
+  }
+  scratch_release(mark);
+}
+/*---------------------------------------------------------------------------*/
+static const uip_ipaddr_t *
+parent(void)
+{
+  rpl_dag_t *dag;
+
+  dag = rpl_get_any_dag();
+  if(dag != NULL && dag->preferred_parent != NULL) {
+    return rpl_get_parent_ipaddr(dag->preferred_parent);
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+entry_fragment(const struct entry *e, uint8_t index, const uint8_t **data)
+{
+  uint16_t offset;
+
+  offset = index * CERT_CACHE_FRAGMENT_LEN;
+  *data = e->data + offset;
+  return e->len - offset < CERT_CACHE_FRAGMENT_LEN ?
+    e->len - offset : CERT_CACHE_FRAGMENT_LEN;
+}
+/*---------------------------------------------------------------------------*/
+static struct entry *
+lookup(const uint8_t *digest)
+{
+  int i;
+
+  for(i = 0; i < CERT_CACHE_ENTRIES; i++) {
+    if(entries[i].state != ENTRY_FREE &&
+       memcmp(entries[i].digest, digest, SHA256_BLOCK_SIZE) == 0) {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_pool(void)
+{
+  uint16_t used;
+  int i;
+
+  used = 0;
+  for(i = 0; i < CERT_CACHE_ENTRIES; i++) {
+    used += entries[i].state != ENTRY_FREE;
+  }
+  ram_pool_set(&entry_pool, used);
+}
+/*---------------------------------------------------------------------------*/
+/* Keeps a fragment passing through; checks the digest once complete. */
+static void
+stage(const uint8_t *digest, uint8_t index, uint8_t count,
+      const uint8_t *data, uint16_t len)
+{
+  scratch_mark_t mark;
+  SHA256_CTX *ctx;
+  uint8_t hash[SHA256_BLOCK_SIZE];
+  struct entry *e;
+  uint16_t offset;
+  int i;
+
+  offset = index * CERT_CACHE_FRAGMENT_LEN;
+  if(count > MAX_FRAGMENTS ||
+     (count - 1) * CERT_CACHE_FRAGMENT_LEN >= CERT_CACHE_ENTRY_SIZE ||
+     offset + len > CERT_CACHE_ENTRY_SIZE) {
+    return;
+  }
+  e = lookup(digest);
+  if(e == NULL) {
+    e = &entries[0];
+    for(i = 1; i < CERT_CACHE_ENTRIES && e->state != ENTRY_FREE; i++) {
+      if(entries[i].state == ENTRY_FREE || entries[i].used < e->used) {
+        e = &entries[i];
+      }
+    }
+    memcpy(e->digest, digest, SHA256_BLOCK_SIZE);
+    e->state = ENTRY_FILLING;
+    e->count = count;
+    e->have = 0;
+    e->len = 0;
+    update_pool();
+  } else if(e->state == ENTRY_VALID || e->count != count) {
+    return;
+  }
+  memcpy(e->data + offset, data, len);
+  e->have |= 1UL << index;
+  if(offset + len > e->len) {
+    e->len = offset + len;
+  }
+  e->used = clock_time();
+  if(e->have != (count == MAX_FRAGMENTS ? 0xffffffffUL : (1UL << count) - 1)) {
+    return;
+  }
+  mark = scratch_mark();
+  ctx = scratch_alloc(sizeof(*ctx));
+  if(ctx != NULL) {
+    sha256_init(ctx);
+    sha256_update(ctx, e->data, e->len);
+    sha256_final(ctx, hash);
+  }
+  scratch_release(mark);
+  if(ctx != NULL && memcmp(hash, e->digest, SHA256_BLOCK_SIZE) == 0) {
+    e->state = ENTRY_VALID;
+  } else {
+    printf("cache: certificate does not match its digest\n");
+    e->state = ENTRY_FREE;
+    update_pool();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* 1 if the request joins one already sent up, 0 if it must be sent. */
+static int
+pending_add(const uip_ipaddr_t *child, const uint8_t *digest, uint8_t index)
+{
+  struct pending *free;
+  int found;
+  int i;
+
+  free = NULL;
+  found = 0;
+  for(i = 0; i < CERT_CACHE_PENDING; i++) {
+    if(pending[i].used &&
+       clock_time() - pending[i].since > CERT_CACHE_TIMEOUT) {
+      pending[i].used = 0;
+    }
+    if(!pending[i].used) {
+      if(free == NULL) {
+        free = &pending[i];
+      }
+    } else if(pending[i].index == index &&
+              memcmp(pending[i].key, digest, KEY_LEN) == 0) {
+      if(uip_ipaddr_cmp(&pending[i].child, child)) {
+        /* A retry: send it up again. */
+        pending[i].since = clock_time();
+        return 0;
+      }
+      found = 1;
+    }
+  }
+  if(free != NULL) {
+    uip_ipaddr_copy(&free->child, child);
+    memcpy(free->key, digest, KEY_LEN);
+    free->index = index;
+    free->since = clock_time();
+    free->used = 1;
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_input(const uip_ipaddr_t *from, const uint8_t *digest, uint8_t index)
+{
+  const uip_ipaddr_t *up;
+  const uint8_t *data;
+  struct entry *e;
+  uint16_t len;
+
+  if(memcmp(digest, own_digest, SHA256_BLOCK_SIZE) == 0) {
+    if(index < own_count) {
+      send_fragment(from, digest, index, own_count, NULL, 0);
+    }
+    return;
+  }
+  e = lookup(digest);
+  if(e != NULL && e->state == ENTRY_VALID && index < e->count) {
+    hits++;
+    e->used = clock_time();
+    len = entry_fragment(e, index, &data);
+    send_fragment(from, digest, index, e->count, data, len);
+    return;
+  }
+  misses++;
+  if(pending_add(from, digest, index)) {
+    merged++;
+    return;
+  }
+  up = parent();
+  if(up != NULL) {
+    send_request(up, digest, index);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void fetch_request(void);
+
+static void
+fetch_done(void *ptr)
+{
+  fetch.done(fetch.ok);
+}
+/*---------------------------------------------------------------------------*/
+/* The outcome is reported from a timer, once the input buffers are gone. */
+static void
+fetch_finish(int ok)
+{
+  fetch.active = 0;
+  fetch.ok = ok;
+  ctimer_set(&fetch_timer, 0, fetch_done, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fetch_next(const uint8_t *data, uint16_t len, uint8_t count)
+{
+  uint8_t hash[SHA256_BLOCK_SIZE];
+
+  fetch.fragment(data, len);
+  sha256_update(&fetch.ctx, data, len);
+  fetch.index++;
+  fetch.tries = 0;
+  if(fetch.index < count) {
+    fetch_request();
+    return;
+  }
+  sha256_final(&fetch.ctx, hash);
+  fetch_finish(memcmp(hash, fetch.digest, SHA256_BLOCK_SIZE) == 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fetch_timeout(void *ptr)
+{
+  if(++fetch.tries == FETCH_TRIES) {
+    if(fetch.direct) {
+      fetch_finish(0);
+      return;
+    }
+    printf("cache: parent silent, asking the provider\n");
+    fetch.direct = 1;
+    fetch.tries = 0;
+  }
+  fetch_request();
+}
+/*---------------------------------------------------------------------------*/
+static void
+fetch_request(void)
+{
+  const uip_ipaddr_t *up;
+
+  up = fetch.direct ? NULL : parent();
+  if(up == NULL) {
+    fetch.direct = 1;
+    up = &fetch.origin;
+  }
+  send_request(up, fetch.digest, fetch.index);
+  ctimer_set(&fetch_timer, CERT_CACHE_TIMEOUT, fetch_timeout, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fragment_input(const uint8_t *digest, uint8_t index, uint8_t count,
+               const uint8_t *data, uint16_t len)
+{
+  int i;
+
+  stage(digest, index, count, data, len);
+  for(i = 0; i < CERT_CACHE_PENDING; i++) {
+    if(pending[i].used && pending[i].index == index &&
+       memcmp(pending[i].key, digest, KEY_LEN) == 0) {
+      send_fragment(&pending[i].child, digest, index, count, data, len);
+      pending[i].used = 0;
+    }
+  }
+  if(fetch.active && fetch.index == index &&
+     memcmp(fetch.digest, digest, SHA256_BLOCK_SIZE) == 0) {
+    fetch_next(data, len, count);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_cache_init(void)
+{
+  conn = udp_new(NULL, 0, NULL);
+  udp_bind(conn, UIP_HTONS(CERT_CACHE_PORT));
+  cert_cache_own_changed();
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_cache_own_changed(void)
+{
+  scratch_mark_t mark;
+  SHA256_CTX *ctx;
+  uint8_t *buf;
+  uint8_t i;
+
+  own_count = fragment_count();
+  mark = scratch_mark();
+  ctx = scratch_alloc(sizeof(*ctx));
+  buf = scratch_alloc(CERT_CACHE_FRAGMENT_LEN);
+  if(ctx != NULL && buf != NULL) {
+    sha256_init(ctx);
+    for(i = 0; i < own_count; i++) {
+      sha256_update(ctx, buf,
+                    cert_fragment_load(i, buf, CERT_CACHE_FRAGMENT_LEN));
+    }
+    sha256_final(ctx, own_digest);
+  }
+  scratch_release(mark);
+}
+/*---------------------------------------------------------------------------*/
+const uint8_t *
+cert_cache_own_digest(void)
+{
+  return own_digest;
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_cache_fetch(const uint8_t digest[SHA256_BLOCK_SIZE],
+                 const uip_ipaddr_t *origin,
+                 cert_cache_fragment_cb fragment,
+                 cert_cache_done_cb done)
+{
+  const uint8_t *data;
+  struct entry *e;
+  uint16_t len;
+  uint8_t i;
+
+  memcpy(fetch.digest, digest, SHA256_BLOCK_SIZE);
+  uip_ipaddr_copy(&fetch.origin, origin);
+  fetch.fragment = fragment;
+  fetch.done = done;
+  fetch.index = 0;
+  fetch.tries = 0;
+  fetch.direct = 0;
+  sha256_init(&fetch.ctx);
+
+  e = lookup(digest);
+  if(e != NULL && e->state == ENTRY_VALID) {
+    /* Already checked when it was cached. */
+    hits++;
+    e->used = clock_time();
+    for(i = 0; i < e->count; i++) {
+      len = entry_fragment(e, i, &data);
+      fragment(data, len);
+    }
+    done(1);
+    return;
+  }
+  fetch.active = 1;
+  fetch_request();
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_cache_insert(const uint8_t *cert, uint16_t len)
+{
+  uint8_t digest[SHA256_BLOCK_SIZE];
+  scratch_mark_t mark;
+  SHA256_CTX *ctx;
+  uint16_t offset;
+  uint8_t count;
+  uint8_t i;
+
+  mark = scratch_mark();
+  ctx = scratch_alloc(sizeof(*ctx));
+  if(ctx != NULL) {
+    sha256_init(ctx);
+    sha256_update(ctx, cert, len);
+    sha256_final(ctx, digest);
+  }
+  scratch_release(mark);
+  if(ctx == NULL) {
+    return;
+  }
+  count = (len + CERT_CACHE_FRAGMENT_LEN - 1) / CERT_CACHE_FRAGMENT_LEN;
+  for(i = 0; i < count; i++) {
+    offset = i * CERT_CACHE_FRAGMENT_LEN;
+    stage(digest, i, count, cert + offset,
+          len - offset < CERT_CACHE_FRAGMENT_LEN ? len - offset : CERT_CACHE_FRAGMENT_LEN);
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct uip_udp_conn *
+cert_cache_conn(void)
+{
+  return conn;
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_cache_input(void)
+{
+  scratch_mark_t mark;
+  uip_ipaddr_t from;
+  uint8_t *buf;
+  uint8_t *p;
+  int len;
+
+  if(!uip_newdata()) {
+    return;
+  }
+  bytes += uip_datalen();
+  mark = scratch_mark();
+  buf = scratch_alloc(MAX_MSG_LEN + CERT_CRYPTO_OVERHEAD);
+  if(buf == NULL || uip_datalen() > MAX_MSG_LEN + CERT_CRYPTO_OVERHEAD) {
+    scratch_release(mark);
+    return;
+  }
+  /* Replies reuse uip_buf, so work on a copy. */
+  uip_ipaddr_copy(&from, &UIP_IP_BUF->srcipaddr);
+  memcpy(buf, uip_appdata, uip_datalen());
+  len = cert_crypto_open(buf, uip_datalen());
+  p = buf + CERT_CRYPTO_HDR_LEN;
+  if(len == REQUEST_LEN && p[0] == MSG_REQUEST) {
+    request_input(&from, p + 1, p[1 + SHA256_BLOCK_SIZE]);
+  } else if(len >= FRAGMENT_HDR_LEN && p[0] == MSG_FRAGMENT &&
+            p[1 + SHA256_BLOCK_SIZE] < p[2 + SHA256_BLOCK_SIZE]) {
+    fragment_input(p + 1, p[1 + SHA256_BLOCK_SIZE], p[2 + SHA256_BLOCK_SIZE],
+                   p + FRAGMENT_HDR_LEN, len - FRAGMENT_HDR_LEN);
+  }
+  scratch_release(mark);
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+cert_cache_bytes(void)
+{
+  return bytes;
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_cache_stats(void)
+{
+  int valid;
+  int i;
+
+  valid = 0;
+  for(i = 0; i < CERT_CACHE_ENTRIES; i++) {
+    valid += entries[i].state == ENTRY_VALID;
+  }
+  printf("cache: entries [%u/%u] hits [%lu] misses [%lu] merged [%lu] bytes [%lu]\n",
+         valid, CERT_CACHE_ENTRIES, hits, misses, merged, bytes);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* CERT_CACHE_ENABLED */
@@ -0,0 +1,133 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         In-network certificate cache. With CERT_CACHE the provider's
+ *         flight replies carry the digest of its certificate instead of
+ *         the fragments, and the client pulls the certificate one
+ *         fragment at a time from its RPL preferred parent:
+ *
+ *           REQUEST  ['Q'][digest (32)][index (1)]
+ *           FRAGMENT ['F'][digest (32)][index (1)][count (1)][data]
+ *
+ *         A node answers from its own certificate or its cache, and
+ *         otherwise forwards the request to its own parent, so requests
+ *         for the same fragment from a subtree are merged on the way up.
+ *         Fragments passing through are kept until the whole certificate
+ *         is there; it is then hashed and, if it matches the digest,
+ *         served from then on. Entries are replaced least recently used.
+ *
+ *         A client whose parents cannot deliver falls back to asking the
+ *         provider directly.
+ */
+
+#ifndef CERT_CACHE_H_
+#define CERT_CACHE_H_
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "sha256.h"
+
+#ifdef CERT_CACHE_CONF_ENABLED
+#define CERT_CACHE_ENABLED CERT_CACHE_CONF_ENABLED
+#else
+#define CERT_CACHE_ENABLED 0
+#endif
+
+/* Cached certificates. */
+#ifdef CERT_CACHE_CONF_ENTRIES
+#define CERT_CACHE_ENTRIES CERT_CACHE_CONF_ENTRIES
+#else
+#define CERT_CACHE_ENTRIES 2
+#endif
+
+/* Bytes per entry; larger certificates are relayed but not kept. The
+   default holds the CBOR profile, the 18 fragment chain needs 2304. */
+#ifdef CERT_CACHE_CONF_ENTRY_SIZE
+#define CERT_CACHE_ENTRY_SIZE CERT_CACHE_CONF_ENTRY_SIZE
+#elif CONTIKI_TARGET_NATIVE
+#define CERT_CACHE_ENTRY_SIZE 2304
+#else
+#define CERT_CACHE_ENTRY_SIZE 256
+#endif
+
+/* Requests from children waiting for the parent's answer. */
+#ifdef CERT_CACHE_CONF_PENDING
+#define CERT_CACHE_PENDING CERT_CACHE_CONF_PENDING
+#else
+#define CERT_CACHE_PENDING 4
+#endif
+
+/* Per fragment; a fetch gives up on the parent after three. */
+#ifdef CERT_CACHE_CONF_TIMEOUT
+#define CERT_CACHE_TIMEOUT CERT_CACHE_CONF_TIMEOUT
+#else
+#define CERT_CACHE_TIMEOUT (CLOCK_SECOND * 4)
+#endif
+
+#define CERT_CACHE_PORT 5691
+
+/* Fragment size, as in the flight. */
+#define CERT_CACHE_FRAGMENT_LEN 128
+
+/* Each fragment of a fetch, in order, then the outcome. */
+typedef void (*cert_cache_fragment_cb)(const uint8_t *data, uint16_t len);
+typedef void (*cert_cache_done_cb)(int ok);
+
+/* Binds the port and hashes this node's own certificate. */
+void cert_cache_init(void);
+
+const uint8_t *cert_cache_own_digest(void);
+
+/* Hashes the own certificate again after cert_crypto_rotate(). */
+void cert_cache_own_changed(void);
+
+/* Adds a whole certificate obtained some other way, e.g. by Trickle. */
+void cert_cache_insert(const uint8_t *cert, uint16_t len);
+
+/*
+ * Fetches the certificate with the given digest, through the preferred
+ * parent and then from origin directly. done is called with 1 once all
+ * fragments have been passed to fragment and their hash matched.
+ */
+void cert_cache_fetch(const uint8_t digest[SHA256_BLOCK_SIZE],
+                      const uip_ipaddr_t *origin,
+                      cert_cache_fragment_cb fragment,
+                      cert_cache_done_cb done);
+
+/* tcpip_event on the connection below. */
+void cert_cache_input(void);
+struct uip_udp_conn *cert_cache_conn(void);
+
+/* UDP payload bytes sent and received on the cache port. */
+unsigned long cert_cache_bytes(void);
+
+/* Entries, hits, misses and merged requests on one line. */
+void cert_cache_stats(void);
+
+#endif /* CERT_CACHE_H_ */
@@ -0,0 +1,319 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Compact CBOR certificate profile.
+ */
+
+#include "contiki.h"
+#include "cert-cbor.h"
+#include "scratch.h"
+
+#include <string.h>
+
+#define MAJOR_UINT  0
+#define MAJOR_BYTES 2
+#define MAJOR_ARRAY 4
+#define MAJOR_OTHER 7
+#define CBOR_NULL   22
+
+/* Where the bytes of the encoding in [offset, end) go. */
+struct emitter {
+  uint16_t pos;
+  uint16_t offset;
+  uint16_t end;
+  uint8_t *buf;
+  SHA256_CTX *hash;
+};
+
+/*---------------------------------------------------------------------------*/
+static void
+emit(struct emitter *e, const uint8_t *p, uint16_t n)
+{
+  uint16_t from, to;
+
+  from = e->pos > e->offset ? e->pos : e->offset;
+  to = e->pos + n < e->end ? e->pos + n : e->end;
+  if(from < to) {
+    if(e->buf != NULL) {
+      memcpy(e->buf + (from - e->offset), p + (from - e->pos), to - from);
+    }
+    if(e->hash != NULL) {
+      sha256_update(e->hash, p + (from - e->pos), to - from);
+    }
+  }
+  e->pos += n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+emit_head(struct emitter *e, uint8_t major, uint32_t arg)
+{
+  uint8_t h[5];
+  uint8_t n;
+
+  if(arg < 24) {
+    h[0] = (major << 5) | arg;
+    n = 1;
+  } else if(arg <= 0xff) {
+    h[0] = (major << 5) | 24;
+    h[1] = arg;
+    n = 2;
+  } else if(arg <= 0xffff) {
+    h[0] = (major << 5) | 25;
+    h[1] = arg >> 8;
+    h[2] = arg;
+    n = 3;
+  } else {
+    h[0] = (major << 5) | 26;
+    h[1] = arg >> 24;
+    h[2] = arg >> 16;
+    h[3] = arg >> 8;
+    h[4] = arg;
+    n = 5;
+  }
+  emit(e, h, n);
+}
+/*---------------------------------------------------------------------------*/
+static void
+emit_bytes(struct emitter *e, const uint8_t *p, uint16_t n)
+{
+  emit_head(e, MAJOR_BYTES, n);
+  emit(e, p, n);
+}
+/*---------------------------------------------------------------------------*/
+static void
+encode(const struct cert_cbor *c, struct emitter *e, uint8_t tbs_only)
+{
+  static const uint8_t null = (MAJOR_OTHER << 5) | CBOR_NULL;
+
+  if(!tbs_only) {
+    emit_head(e, MAJOR_ARRAY, CERT_CBOR_ITEMS - 1);
+  }
+  emit_head(e, MAJOR_UINT, CERT_CBOR_TYPE);
+  emit_bytes(e, c->serial, c->serial_len);
+  emit_head(e, MAJOR_UINT, c->issuer);
+  emit_head(e, MAJOR_UINT, c->not_before);
+  if(c->not_after != 0) {
+    emit_head(e, MAJOR_UINT, c->not_after);
+  } else {
+    emit(e, &null, 1);
+  }
+  emit_bytes(e, c->subject, CERT_CBOR_SUBJECT_LEN);
+  emit_head(e, MAJOR_UINT, c->key_alg);
+  emit_bytes(e, c->public_key, CERT_CBOR_KEY_LEN);
+  emit_head(e, MAJOR_UINT, c->key_usage);
+  emit_head(e, MAJOR_UINT, c->sig_alg);
+  if(!tbs_only) {
+    emit_bytes(e, c->signature, CERT_CBOR_SIG_LEN);
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+cert_cbor_size(const struct cert_cbor *c)
+{
+  struct emitter e;
+
+  memset(&e, 0, sizeof(e));
+  encode(c, &e, 0);
+  return e.pos;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+cert_cbor_encode(const struct cert_cbor *c, uint16_t offset,
+                 uint8_t *buf, uint16_t len)
+{
+  struct emitter e;
+
+  memset(&e, 0, sizeof(e));
+  e.offset = offset;
+  e.end = offset + len;
+  e.buf = buf;
+  encode(c, &e, 0);
+  if(e.pos <= offset) {
+    return 0;
+  }
+  return e.pos - offset < len ? e.pos - offset : len;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_cbor_tbs_hash(const struct cert_cbor *c, uint8_t digest[SHA256_BLOCK_SIZE])
+{
+  scratch_mark_t mark;
+  SHA256_CTX *ctx;
+  struct emitter e;
+
+  mark = scratch_mark();
+  ctx = scratch_alloc(sizeof(*ctx));
+  if(ctx == NULL) {
+    return -1;
+  }
+  sha256_init(ctx);
+  memset(&e, 0, sizeof(e));
+  e.end = 0xffff;
+  e.hash = ctx;
+  encode(c, &e, 1);
+  sha256_final(ctx, digest);
+  scratch_release(mark);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Destination and exact length of byte string items; serial is the
+   only one whose length may vary. */
+static uint8_t *
+string_item(struct cert_cbor *c, uint8_t item, uint16_t *len)
+{
+  switch(item) {
+  case 2:
+    *len = c->serial_len;
+    return c->serial;
+  case 6:
+    *len = CERT_CBOR_SUBJECT_LEN;
+    return c->subject;
+  case 8:
+    *len = CERT_CBOR_KEY_LEN;
+    return c->public_key;
+  case 11:
+    *len = CERT_CBOR_SIG_LEN;
+    return c->signature;
+  }
+  *len = 0;
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+head_done(struct cert_cbor_decoder *d, struct cert_cbor *c)
+{
+  uint16_t len;
+
+  if(string_item(c, d->item, &len) != NULL) {
+    if(d->major != MAJOR_BYTES) {
+      return -1;
+    }
+    if(d->item == 2) {
+      if(d->arg > CERT_CBOR_SERIAL_MAX) {
+        return -1;
+      }
+      c->serial_len = d->arg;
+    } else if(d->arg != len) {
+      return -1;
+    }
+    d->left = d->arg;
+    return d->left == 0;
+  }
+
+  if(d->item == 0) {
+    return d->major == MAJOR_ARRAY && d->arg == CERT_CBOR_ITEMS - 1 ? 1 : -1;
+  }
+  if(d->item == 5 && d->major == MAJOR_OTHER && d->arg == CBOR_NULL) {
+    c->not_after = 0;
+    return 1;
+  }
+  if(d->major != MAJOR_UINT) {
+    return -1;
+  }
+  switch(d->item) {
+  case 1:
+    return d->arg == CERT_CBOR_TYPE ? 1 : -1;
+  case 4:
+    c->not_before = d->arg;
+    return 1;
+  case 5:
+    c->not_after = d->arg;
+    return 1;
+  }
+  if(d->arg > 0xff) {
+    return -1;
+  }
+  switch(d->item) {
+  case 3:
+    c->issuer = d->arg;
+    break;
+  case 7:
+    c->key_alg = d->arg;
+    break;
+  case 9:
+    c->key_usage = d->arg;
+    break;
+  case 10:
+    c->sig_alg = d->arg;
+    break;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_cbor_decode(struct cert_cbor_decoder *d, struct cert_cbor *c,
+                 const uint8_t *data, uint16_t len)
+{
+  uint8_t *dst;
+  uint16_t n;
+  uint8_t ai;
+  int done;
+
+  while(len > 0 && !d->error) {
+    if(d->item == CERT_CBOR_ITEMS) {
+      /* Trailing bytes after a complete certificate. */
+      d->error = 1;
+      break;
+    }
+    if(d->left > 0) {
+      dst = string_item(c, d->item, &n);
+      n = n - d->left;
+      dst[n] = *data;
+      done = --d->left == 0;
+    } else if(d->need > 0) {
+      d->arg = (d->arg << 8) | *data;
+      done = --d->need == 0 ? head_done(d, c) : 0;
+    } else {
+      d->major = *data >> 5;
+      ai = *data & 0x1f;
+      d->arg = 0;
+      if(ai < 24) {
+        d->arg = ai;
+        done = head_done(d, c);
+      } else if(ai <= 26) {
+        d->need = 1 << (ai - 24);
+        done = 0;
+      } else {
+        done = -1;
+      }
+    }
+    if(done < 0) {
+      d->error = 1;
+    } else if(done) {
+      d->item++;
+    }
+    data++;
+    len--;
+  }
+  if(d->error) {
+    return CERT_CBOR_ERROR;
+  }
+  return d->item == CERT_CBOR_ITEMS ? CERT_CBOR_DONE : CERT_CBOR_MORE;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,123 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Compact CBOR certificate profile, in the spirit of C509: one
+ *         CBOR array with short identifiers instead of DNs and OIDs,
+ *         implicit fields and a compressed P-256 point.
+ *
+ *           [ type, serial, issuer, not_before, not_after / null,
+ *             subject, key_alg, public_key, key_usage, sig_alg,
+ *             signature ]
+ *
+ *         type, issuer, key_alg, key_usage and sig_alg are small
+ *         integers; serial (up to CERT_CBOR_SERIAL_MAX bytes), subject
+ *         (EUI-64), public_key (33 bytes) and signature (r || s, 64
+ *         bytes) are byte strings. The to-be-signed part is every item
+ *         after the array head up to, not including, the signature.
+ *
+ *         Both directions are streaming: cert_cbor_encode() produces
+ *         any byte range of the encoding without building it, and the
+ *         decoder accepts the encoding in pieces of any size, so a
+ *         certificate is decoded fragment by fragment as it arrives.
+ */
+
+#ifndef CERT_CBOR_H_
+#define CERT_CBOR_H_
+
+#include "contiki.h"
+#include "sha256.h"
+
+#ifdef CERT_CBOR_CONF_ENABLED
+#define CERT_CBOR_ENABLED CERT_CBOR_CONF_ENABLED
+#else
+#define CERT_CBOR_ENABLED 0
+#endif
+
+#define CERT_CBOR_TYPE         1
+#define CERT_CBOR_SERIAL_MAX   8
+#define CERT_CBOR_SUBJECT_LEN  8
+#define CERT_CBOR_KEY_LEN      33
+#define CERT_CBOR_SIG_LEN      64
+#define CERT_CBOR_ISSUER_CA    1   /* C=SE, O=Contiki PUF CA, CN=cert-service-provider */
+#define CERT_CBOR_KEY_P256     1   /* id-ecPublicKey, prime256v1, compressed */
+#define CERT_CBOR_SIG_ECDSA256 0   /* ecdsa-with-SHA256 */
+#define CERT_CBOR_USAGE_SIGN   0x01
+#define CERT_CBOR_USAGE_KEYAGREE 0x10
+
+struct cert_cbor {
+  uint8_t serial[CERT_CBOR_SERIAL_MAX];
+  uint8_t serial_len;
+  uint8_t issuer;
+  uint32_t not_before;
+  uint32_t not_after;     /* 0: no expiry, encoded as null */
+  uint8_t subject[CERT_CBOR_SUBJECT_LEN];
+  uint8_t key_alg;
+  uint8_t public_key[CERT_CBOR_KEY_LEN];
+  uint8_t key_usage;
+  uint8_t sig_alg;
+  uint8_t signature[CERT_CBOR_SIG_LEN];
+};
+
+/* Zero-initialised state is the start of a certificate. */
+struct cert_cbor_decoder {
+  uint8_t item;           /* 0 is the array head, CERT_CBOR_ITEMS when done */
+  uint8_t need;           /* argument bytes of the head still to come */
+  uint8_t major;
+  uint8_t error;
+  uint16_t left;          /* bytes of the current byte string still to come */
+  uint32_t arg;
+};
+
+#define CERT_CBOR_ITEMS 12
+
+enum {
+  CERT_CBOR_ERROR = -1,
+  CERT_CBOR_MORE = 0,
+  CERT_CBOR_DONE = 1
+};
+
+/* Encoded size of c. */
+uint16_t cert_cbor_size(const struct cert_cbor *c);
+
+/* Copies bytes [offset, offset + len) of the encoding of c to buf.
+   Returns the number copied, less than len at the end. */
+uint16_t cert_cbor_encode(const struct cert_cbor *c, uint16_t offset,
+                          uint8_t *buf, uint16_t len);
+
+/* SHA-256 of the to-be-signed part, streamed from the encoder.
+   Returns -1 if the scratch arena is exhausted. */
+int cert_cbor_tbs_hash(const struct cert_cbor *c,
+                       uint8_t digest[SHA256_BLOCK_SIZE]);
+
+/* Feeds the next len bytes of an encoding. Returns CERT_CBOR_MORE,
+   CERT_CBOR_DONE once c is complete, or CERT_CBOR_ERROR. */
+int cert_cbor_decode(struct cert_cbor_decoder *d, struct cert_cbor *c,
+                     const uint8_t *data, uint16_t len);
+
+#endif /* CERT_CBOR_H_ */
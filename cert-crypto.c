@@ -0,0 +1,713 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Crypto steps of the certificate handshake, shared by the
+ *         service client and the service provider.
+ */
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+#include "cert-crypto.h"
+#include "auth-prof.h"
+#include "scratch.h"
+#include "cert-store.h"
+#include "cert-cbor.h"
+#include "cert-revoke.h"
+#include "cfs/cfs.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Bytes pushed through AES-CCM per encryption_decryption() call. */
+#define CERT_CRYPTO_BENCH_LEN 128
+
+/*
+ * The seal counter is leased from flash in blocks of SEAL_LEASE: the
+ * end of the current block is saved before any counter in it is used,
+ * and a reboot continues from there, so no nonce repeats under the
+ * static key. The top bit is left to the native gateway's workers.
+ *
+ * Leases alternate between two files holding [end][~end], so a write
+ * torn by a power loss leaves the other one intact. With neither file
+ * the node is new and starts at 0; with files but no intact record it
+ * refuses to seal rather than guess.
+ */
+#define SEAL_FILE_0 "sealctr0"
+#define SEAL_FILE_1 "sealctr1"
+#define SEAL_LEASE 1024UL
+#define SEAL_LIMIT 0x80000000UL
+
+/*
+ * Pre-shared fragment key. Stand-in until key_generation_exponential()
+ * yields a real session key.
+ */
+static const uint8_t fragment_key[AES_128_KEY_LEN] = {
+  0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+  0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static struct aes_128_ctx fragment_ctx;
+static uint32_t seal_counter;
+static uint32_t seal_lease_end;
+/* File holding the current lease, the other one is written next. */
+static uint8_t seal_slot;
+
+/*
+ * Every certificate of our profile starts with the same bytes: the
+ * issuer, the algorithm identifiers and the validity template come
+ * before the serial number and subject. Hashing of those is done once.
+ */
+static const uint8_t cert_prefix[] = {
+  /* version: [0] INTEGER 2 (v3) */
+  0xa0, 0x03, 0x02, 0x01, 0x02,
+  /* signature algorithm: ecdsa-with-SHA256 */
+  0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02,
+  /* issuer: C=SE, O=Contiki PUF CA, CN=cert-service-provider */
+  0x30, 0x46, 0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13,
+  0x02, 0x53, 0x45, 0x31, 0x17, 0x30, 0x15, 0x06, 0x03, 0x55, 0x04, 0x0a,
+  0x0c, 0x0e, 0x43, 0x6f, 0x6e, 0x74, 0x69, 0x6b, 0x69, 0x20, 0x50, 0x55,
+  0x46, 0x20, 0x43, 0x41, 0x31, 0x1e, 0x30, 0x1c, 0x06, 0x03, 0x55, 0x04,
+  0x03, 0x0c, 0x15, 0x63, 0x65, 0x72, 0x74, 0x2d, 0x73, 0x65, 0x72, 0x76,
+  0x69, 0x63, 0x65, 0x2d, 0x70, 0x72, 0x6f, 0x76, 0x69, 0x64, 0x65, 0x72,
+  /* validity template: 20150101000000Z - 20350101000000Z */
+  0x30, 0x22, 0x18, 0x0f, 0x32, 0x30, 0x31, 0x35, 0x30, 0x31, 0x30, 0x31,
+  0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x5a, 0x18, 0x0f, 0x32, 0x30, 0x33,
+  0x35, 0x30, 0x31, 0x30, 0x31, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x5a,
+  /* subject key algorithm: id-ecPublicKey, prime256v1 */
+  0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01, 0x06,
+  0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07
+};
+
+/* SHA-256 state after cert_prefix, taken in cert_crypto_init(). */
+static SHA256_CTX cert_prefix_ctx;
+
+struct cert_hash_scratch {
+  SHA256_CTX ctx;
+  BYTE digest[SHA256_BLOCK_SIZE];
+};
+
+/*---------------------------------------------------------------------------*/
+static const uint8_t filler[64] = {
+  'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A',
+  'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A',
+  'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A',
+  'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A'
+};
+
+#if CERT_CBOR_ENABLED
+static struct cert_cbor own_cert;
+static void own_cert_update(void);
+/* Bumped by cert_crypto_rotate(), part of the serial once non-zero. */
+static uint8_t rotations;
+#endif /* CERT_CBOR_ENABLED */
+
+#if CERT_STORE_ENABLED
+static int anchor_slot = -1;
+static int chain_slot = -1;
+#endif /* CERT_STORE_ENABLED */
+
+#if CERT_REVOKE_ENABLED
+#if !CERT_CBOR_ENABLED
+#error "CERT_REVOKE needs CERT_CBOR: only a decoded peer certificate has a digest"
+#endif /* !CERT_CBOR_ENABLED */
+/* TBS digest of the peer certificate last accepted by cert_peer_input(). */
+static uint8_t verified_digest[SHA256_BLOCK_SIZE];
+#endif /* CERT_REVOKE_ENABLED */
+
+/*---------------------------------------------------------------------------*/
+static void
+hash_cert_body(SHA256_CTX *ctx, uint16_t len)
+{
+  uint16_t n;
+
+  /* Stand-in certificate body, fed in chunks so it never sits in RAM. */
+  while(len > 0) {
+    n = len < sizeof(filler) ? len : sizeof(filler);
+    sha256_update(ctx, filler, n);
+    len -= n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+report_midstate_savings(void)
+{
+  scratch_mark_t mark;
+  struct cert_hash_scratch *h;
+  rtimer_clock_t t0, t1, t2;
+
+  mark = scratch_mark();
+  h = scratch_alloc(sizeof(*h));
+  if(h == NULL) {
+    return;
+  }
+  t0 = RTIMER_NOW();
+  sha256_init(&h->ctx);
+  sha256_update(&h->ctx, cert_prefix, sizeof(cert_prefix));
+  hash_cert_body(&h->ctx, CERT_LEN - sizeof(cert_prefix));
+  sha256_final(&h->ctx, h->digest);
+  t1 = RTIMER_NOW();
+  cert_hash_begin(&h->ctx);
+  hash_cert_body(&h->ctx, CERT_LEN - sizeof(cert_prefix));
+  sha256_final(&h->ctx, h->digest);
+  t2 = RTIMER_NOW();
+  scratch_release(mark);
+
+  printf("cert hash: prefix [%u] B saves [%u] of [%u] compressions, full [%lu] ticks, midstate [%lu] ticks\n",
+         (unsigned)sizeof(cert_prefix), (unsigned)(sizeof(cert_prefix) / 64),
+         (unsigned)((CERT_LEN + 9 + 63) / 64),
+         (unsigned long)(rtimer_clock_t)(t1 - t0),
+         (unsigned long)(rtimer_clock_t)(t2 - t1));
+}
+/*---------------------------------------------------------------------------*/
+#if CERT_STORE_ENABLED
+static int
+put_filler(uint16_t len)
+{
+  uint16_t n;
+
+  while(len > 0) {
+    n = len < sizeof(filler) ? len : sizeof(filler);
+    if(cert_store_put(filler, n) < 0) {
+      return -1;
+    }
+    len -= n;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+provision(const char *subject)
+{
+  static const uint8_t end_of_fragment = 0;
+  uint8_t id[CERT_STORE_ID_LEN];
+  int slot;
+  int i;
+
+  cert_store_subject_id(subject, id);
+  slot = cert_store_find(id);
+  if(slot >= 0) {
+    return slot;
+  }
+  /* First boot: write the stand-ins that used to be built in RAM. */
+  if(strcmp(subject, CERT_STORE_ANCHOR) == 0) {
+    if(cert_store_put_begin(id, CERT_LEN - sizeof(cert_prefix)) < 0 ||
+       put_filler(CERT_LEN - sizeof(cert_prefix)) < 0) {
+      cert_store_put_end();
+      return -1;
+    }
+  } else {
+    if(cert_store_put_begin(id, CERT_STORE_FRAGMENTS * CERT_STORE_FRAGMENT_LEN) < 0) {
+      return -1;
+    }
+    for(i = 0; i < CERT_STORE_FRAGMENTS; i++) {
+      if(put_filler(CERT_STORE_FRAGMENT_LEN - 1) < 0 ||
+         cert_store_put(&end_of_fragment, 1) < 0) {
+        cert_store_put_end();
+        return -1;
+      }
+    }
+  }
+  if(cert_store_put_end() < 0) {
+    return -1;
+  }
+  printf("cert store: provisioned [%s]\n", subject);
+  return cert_store_find(id);
+}
+#endif /* CERT_STORE_ENABLED */
+/*---------------------------------------------------------------------------*/
+static const char *
+seal_file(uint8_t slot)
+{
+  return slot ? SEAL_FILE_1 : SEAL_FILE_0;
+}
+/*---------------------------------------------------------------------------*/
+/* Saves the end of the next block of counters into the file not holding
+   the current lease. Returns 0 on success. */
+static int
+seal_lease(void)
+{
+  uint32_t rec[2];
+  uint8_t slot;
+  int fd;
+  int ok;
+
+  rec[0] = seal_counter + SEAL_LEASE;
+  rec[1] = ~rec[0];
+  if(rec[0] >= SEAL_LIMIT) {
+    return -1;
+  }
+  slot = !seal_slot;
+  cfs_remove(seal_file(slot));
+  fd = cfs_open(seal_file(slot), CFS_WRITE);
+  if(fd < 0) {
+    return -1;
+  }
+  ok = cfs_write(fd, rec, sizeof(rec)) == sizeof(rec);
+  cfs_close(fd);
+  if(!ok) {
+    return -1;
+  }
+  seal_slot = slot;
+  seal_lease_end = rec[0];
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Reads a lease file: 1 if intact (end set), 0 if absent, -1 if damaged. */
+static int
+seal_read(uint8_t slot, uint32_t *end)
+{
+  uint32_t rec[2];
+  int fd;
+  int n;
+
+  fd = cfs_open(seal_file(slot), CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  n = cfs_read(fd, rec, sizeof(rec));
+  cfs_close(fd);
+  if(n != sizeof(rec) || rec[1] != ~rec[0]) {
+    return -1;
+  }
+  *end = rec[0];
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+seal_counter_init(void)
+{
+  uint32_t end[2];
+  int found[2];
+
+  /* Sealing stays off unless a lease is saved below. */
+  seal_counter = 0;
+  seal_lease_end = 0;
+  found[0] = seal_read(0, &end[0]);
+  found[1] = seal_read(1, &end[1]);
+  if(found[0] == 1 && (found[1] != 1 || end[0] >= end[1])) {
+    seal_slot = 0;
+    seal_counter = end[0];
+  } else if(found[1] == 1) {
+    seal_slot = 1;
+    seal_counter = end[1];
+  } else if(found[0] < 0 || found[1] < 0) {
+    printf("cert crypto: seal counter lease damaged, sealing disabled\n");
+    return;
+  }
+  if(seal_lease() < 0) {
+    printf("cert crypto: cannot lease seal counters, sealing disabled\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_crypto_init(void)
+{
+  aes_128_set_key(&fragment_ctx, fragment_key);
+  seal_counter_init();
+
+  sha256_init(&cert_prefix_ctx);
+  sha256_update(&cert_prefix_ctx, cert_prefix, sizeof(cert_prefix));
+#if CERT_STORE_ENABLED
+  cert_store_init();
+  anchor_slot = provision(CERT_STORE_ANCHOR);
+  chain_slot = provision(CERT_STORE_CHAIN);
+#endif /* CERT_STORE_ENABLED */
+  report_midstate_savings();
+#if CERT_CBOR_ENABLED
+  own_cert_update();
+  printf("cert cbor: [%u] B encoded, X.509 stand-in flight [%u] B\n",
+         cert_cbor_size(&own_cert),
+         CERT_STORE_FRAGMENTS * CERT_STORE_FRAGMENT_LEN);
+#endif /* CERT_CBOR_ENABLED */
+#if CERT_REVOKE_ENABLED
+  cert_revoke_init();
+#endif /* CERT_REVOKE_ENABLED */
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_hash_begin(SHA256_CTX *ctx)
+{
+  memcpy(ctx, &cert_prefix_ctx, sizeof(*ctx));
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_nonce(uint8_t *nonce, const uint8_t *hdr)
+{
+  memset(nonce, 0, AES_CCM_NONCE_LEN);
+  memcpy(nonce, hdr, CERT_CRYPTO_HDR_LEN);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+cert_crypto_seal_mt(uint8_t *buf, uint16_t len, uint32_t counter)
+{
+  uint8_t nonce[AES_CCM_NONCE_LEN];
+
+  buf[0] = linkaddr_node_addr.u8[LINKADDR_SIZE - 2];
+  buf[1] = linkaddr_node_addr.u8[LINKADDR_SIZE - 1];
+  buf[2] = (uint8_t)(counter >> 24);
+  buf[3] = (uint8_t)(counter >> 16);
+  buf[4] = (uint8_t)(counter >> 8);
+  buf[5] = (uint8_t)counter;
+
+  make_nonce(nonce, buf);
+  aes_ccm_encrypt(&fragment_ctx, nonce, NULL, 0,
+                  buf + CERT_CRYPTO_HDR_LEN, len,
+                  buf + CERT_CRYPTO_HDR_LEN + len);
+  return len + CERT_CRYPTO_OVERHEAD;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+cert_crypto_seal(uint8_t *buf, uint16_t len)
+{
+  if(seal_counter + 1 >= seal_lease_end &&
+     (seal_lease_end == 0 || seal_lease() < 0)) {
+    /* Out of saved counters: a nonce must never be reused. */
+    return 0;
+  }
+  auth_prof_begin(AUTH_PROF_CRYPT);
+  len = cert_crypto_seal_mt(buf, len, ++seal_counter);
+  auth_prof_end(AUTH_PROF_CRYPT);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_crypto_open_mt(uint8_t *buf, uint16_t len)
+{
+  uint8_t nonce[AES_CCM_NONCE_LEN];
+
+  if(len < CERT_CRYPTO_OVERHEAD) {
+    return -1;
+  }
+  len -= CERT_CRYPTO_OVERHEAD;
+
+  make_nonce(nonce, buf);
+  if(!aes_ccm_decrypt(&fragment_ctx, nonce, NULL, 0,
+                      buf + CERT_CRYPTO_HDR_LEN, len,
+                      buf + CERT_CRYPTO_HDR_LEN + len)) {
+    return -1;
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_crypto_open(uint8_t *buf, uint16_t len)
+{
+  int ret;
+
+  auth_prof_begin(AUTH_PROF_CRYPT);
+  ret = cert_crypto_open_mt(buf, len);
+  auth_prof_end(AUTH_PROF_CRYPT);
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_hash_mt(const uint8_t *cert, uint16_t len, uint8_t digest[SHA256_BLOCK_SIZE])
+{
+  SHA256_CTX ctx;
+
+  cert_hash_begin(&ctx);
+  sha256_update(&ctx, cert, len);
+  if(len < CERT_LEN - sizeof(cert_prefix)) {
+    hash_cert_body(&ctx, CERT_LEN - sizeof(cert_prefix) - len);
+  }
+  sha256_final(&ctx, digest);
+}
+/*---------------------------------------------------------------------------*/
+void
+hash_generation(void)
+{
+  scratch_mark_t mark;
+  struct cert_hash_scratch *h;
+
+  auth_prof_begin(AUTH_PROF_HASH);
+  mark = scratch_mark();
+  h = scratch_alloc(sizeof(*h));
+  if(h != NULL) {
+    cert_hash_begin(&h->ctx);
+#if CERT_STORE_ENABLED
+    /* Streamed from flash; the stand-in only if the store failed. */
+    if(cert_store_hash(anchor_slot, &h->ctx) < 0) {
+      cert_hash_begin(&h->ctx);
+      hash_cert_body(&h->ctx, CERT_LEN - sizeof(cert_prefix));
+    }
+#else /* CERT_STORE_ENABLED */
+    hash_cert_body(&h->ctx, CERT_LEN - sizeof(cert_prefix));
+#endif /* CERT_STORE_ENABLED */
+    sha256_final(&h->ctx, h->digest);
+  }
+  scratch_release(mark);
+  auth_prof_end(AUTH_PROF_HASH);
+}
+/*---------------------------------------------------------------------------*/
+#if CERT_CBOR_ENABLED
+/* Fills in own_cert for the current link-layer address. */
+static void
+own_cert_update(void)
+{
+  uint8_t subject[CERT_CBOR_SUBJECT_LEN];
+  uint8_t digest[SHA256_BLOCK_SIZE];
+  SHA256_CTX *ctx;
+  scratch_mark_t mark;
+#if CERT_REVOKE_ENABLED
+  int i;
+#endif /* CERT_REVOKE_ENABLED */
+
+  memset(subject, 0, sizeof(subject));
+  memcpy(subject + sizeof(subject) - LINKADDR_SIZE, linkaddr_node_addr.u8,
+         LINKADDR_SIZE);
+  if(own_cert.serial_len != 0 &&
+     memcmp(own_cert.subject, subject, sizeof(subject)) == 0) {
+    return;
+  }
+  memcpy(own_cert.subject, subject, sizeof(subject));
+  own_cert.serial_len = rotations != 0 ? 3 : 2;
+  own_cert.serial[0] = subject[CERT_CBOR_SUBJECT_LEN - 2];
+  own_cert.serial[1] = subject[CERT_CBOR_SUBJECT_LEN - 1];
+  own_cert.serial[2] = rotations;
+  own_cert.issuer = CERT_CBOR_ISSUER_CA;
+  /* Same validity as the X.509 template. */
+  own_cert.not_before = 1420070400UL;
+  own_cert.not_after = 2051222400UL;
+  own_cert.key_alg = CERT_CBOR_KEY_P256;
+  own_cert.key_usage = CERT_CBOR_USAGE_SIGN | CERT_CBOR_USAGE_KEYAGREE;
+  own_cert.sig_alg = CERT_CBOR_SIG_ECDSA256;
+
+  /* Stand-in key: a compressed point whose x is H(subject). */
+  mark = scratch_mark();
+  ctx = scratch_alloc(sizeof(*ctx));
+  if(ctx != NULL) {
+    sha256_init(ctx);
+    sha256_update(ctx, subject, sizeof(subject));
+    sha256_final(ctx, own_cert.public_key + 1);
+  }
+  scratch_release(mark);
+  own_cert.public_key[0] = 0x02;
+
+  /* Stand-in signature until ECDSA is in: H(tbs) || H(tbs). */
+  cert_cbor_tbs_hash(&own_cert, digest);
+  memcpy(own_cert.signature, digest, SHA256_BLOCK_SIZE);
+  memcpy(own_cert.signature + SHA256_BLOCK_SIZE, digest, SHA256_BLOCK_SIZE);
+#if CERT_REVOKE_ENABLED
+  /* The digest peers check, and the one to list in revoke-filter.py. */
+  printf("revoke: own digest ");
+  for(i = 0; i < SHA256_BLOCK_SIZE; i++) {
+    printf("%02x", digest[i]);
+  }
+  printf("\n");
+#endif /* CERT_REVOKE_ENABLED */
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_crypto_rotate(void)
+{
+  rotations++;
+  /* Rebuilt on next use. */
+  own_cert.serial_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+cert_fragment_count(uint16_t len)
+{
+  own_cert_update();
+  return (cert_cbor_size(&own_cert) + len - 1) / len;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_peer_input(struct cert_cbor_decoder *d, struct cert_cbor *c,
+                const uint8_t *data, uint16_t len)
+{
+  uint8_t digest[SHA256_BLOCK_SIZE];
+  int ret;
+
+  if(d->item == CERT_CBOR_ITEMS) {
+    /* Fragments after the certificate, the batch proof. */
+    return CERT_CBOR_DONE;
+  }
+  if(d->error) {
+    return CERT_CBOR_ERROR;
+  }
+  ret = cert_cbor_decode(d, c, data, len);
+  if(ret == CERT_CBOR_DONE) {
+    if(c->issuer != CERT_CBOR_ISSUER_CA || c->key_alg != CERT_CBOR_KEY_P256 ||
+       c->sig_alg != CERT_CBOR_SIG_ECDSA256 ||
+       cert_cbor_tbs_hash(c, digest) < 0 ||
+       memcmp(c->signature, digest, SHA256_BLOCK_SIZE) != 0) {
+      d->error = 1;
+      ret = CERT_CBOR_ERROR;
+    }
+#if CERT_REVOKE_ENABLED
+    else {
+      memcpy(verified_digest, digest, sizeof(verified_digest));
+    }
+#endif /* CERT_REVOKE_ENABLED */
+  }
+  if(ret == CERT_CBOR_ERROR) {
+    printf("cert cbor: bad certificate from [%u], item [%u]\n",
+           c->subject[CERT_CBOR_SUBJECT_LEN - 2] +
+           (c->subject[CERT_CBOR_SUBJECT_LEN - 1] << 8), d->item);
+  }
+  return ret;
+}
+#endif /* CERT_CBOR_ENABLED */
+/*---------------------------------------------------------------------------*/
+uint16_t
+cert_fragment_load(uint8_t index, uint8_t *buf, uint16_t len)
+{
+#if CERT_CBOR_ENABLED
+  own_cert_update();
+  return cert_cbor_encode(&own_cert, (uint16_t)index * len, buf, len);
+#else /* CERT_CBOR_ENABLED */
+#if CERT_STORE_ENABLED
+  if(cert_store_read(chain_slot, (uint16_t)index * len, buf, len) == len) {
+    return len;
+  }
+#endif /* CERT_STORE_ENABLED */
+  memset(buf, 'A', len);
+  buf[len - 1] = 0;
+  return len;
+#endif /* CERT_CBOR_ENABLED */
+}
+#if CERT_CRYPTO_BENCH
+/*---------------------------------------------------------------------------*/
+static unsigned long
+bytes_per_ms(unsigned long bytes, rtimer_clock_t ticks)
+{
+  if(ticks == 0) {
+    ticks = 1;
+  }
+  return (bytes * RTIMER_SECOND) / ((unsigned long)ticks * 1000);
+}
+#endif /* CERT_CRYPTO_BENCH */
+/*---------------------------------------------------------------------------*/
+void
+encryption_decryption(void)
+{
+  scratch_mark_t mark;
+  uint8_t *buf;
+  int ok;
+#if CERT_CRYPTO_BENCH
+  rtimer_clock_t t0, t1, t2;
+#endif /* CERT_CRYPTO_BENCH */
+
+  mark = scratch_mark();
+  buf = scratch_alloc(CERT_CRYPTO_BENCH_LEN + CERT_CRYPTO_OVERHEAD);
+  if(buf == NULL) {
+    return;
+  }
+  memset(buf + CERT_CRYPTO_HDR_LEN, 'A', CERT_CRYPTO_BENCH_LEN);
+
+#if CERT_CRYPTO_BENCH
+  t0 = RTIMER_NOW();
+  cert_crypto_seal(buf, CERT_CRYPTO_BENCH_LEN);
+  t1 = RTIMER_NOW();
+  ok = cert_crypto_open(buf, CERT_CRYPTO_BENCH_LEN + CERT_CRYPTO_OVERHEAD) ==
+    CERT_CRYPTO_BENCH_LEN;
+  t2 = RTIMER_NOW();
+  printf("aes-ccm [%s] enc [%lu] B/ms dec [%lu] B/ms %s\n", aes_ccm_variant(),
+         bytes_per_ms(CERT_CRYPTO_BENCH_LEN, t1 - t0),
+         bytes_per_ms(CERT_CRYPTO_BENCH_LEN, t2 - t1),
+         ok ? "ok" : "FAILED");
+#else /* CERT_CRYPTO_BENCH */
+  cert_crypto_seal(buf, CERT_CRYPTO_BENCH_LEN);
+  ok = cert_crypto_open(buf, CERT_CRYPTO_BENCH_LEN + CERT_CRYPTO_OVERHEAD) ==
+    CERT_CRYPTO_BENCH_LEN;
+  if(!ok) {
+    printf("aes-ccm [%s] self test FAILED\n", aes_ccm_variant());
+  }
+#endif /* CERT_CRYPTO_BENCH */
+  scratch_release(mark);
+}
+/*---------------------------------------------------------------------------*/
+void
+singnature_varification(void)
+{
+  auth_prof_begin(AUTH_PROF_VERIFY);
+  hash_generation();
+  encryption_decryption();
+  auth_prof_end(AUTH_PROF_VERIFY);
+}
+/*---------------------------------------------------------------------------*/
+#if CERT_REVOKE_ENABLED
+int
+cert_peer_revoke_check(void)
+{
+  int ret;
+
+  auth_prof_begin(AUTH_PROF_VERIFY);
+  ret = cert_revoke_check(verified_digest);
+  auth_prof_end(AUTH_PROF_VERIFY);
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+const uint8_t *
+cert_verified_digest(void)
+{
+  return verified_digest;
+}
+#endif /* CERT_REVOKE_ENABLED */
+/*---------------------------------------------------------------------------*/
+void
+key_generation_exponential(void)
+{
+  unsigned long a =65300 ;
+  unsigned long b=65300;
+  unsigned long key;
+  unsigned long i, j;
+  auth_prof_begin(AUTH_PROF_KEYGEN);
+  for (i =0; i < a; i++) {
+    for (j =0; j< b; j++) {
+      key = key + a;
+    }
+  }
+  auth_prof_end(AUTH_PROF_KEYGEN);
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_root_sign(const uint8_t root[SHA256_BLOCK_SIZE],
+               uint8_t sig[SHA256_BLOCK_SIZE])
+{
+  SHA256_CTX ctx;
+
+  sha256_init(&ctx);
+  sha256_update(&ctx, fragment_key, sizeof(fragment_key));
+  sha256_update(&ctx, root, SHA256_BLOCK_SIZE);
+  sha256_update(&ctx, fragment_key, sizeof(fragment_key));
+  sha256_final(&ctx, sig);
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_root_verify(const uint8_t root[SHA256_BLOCK_SIZE],
+                 const uint8_t sig[SHA256_BLOCK_SIZE])
+{
+  uint8_t expected[SHA256_BLOCK_SIZE];
+
+  cert_root_sign(root, expected);
+  return memcmp(expected, sig, SHA256_BLOCK_SIZE) == 0;
+}
+/*---------------------------------------------------------------------------*/
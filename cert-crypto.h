@@ -0,0 +1,156 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Crypto steps of the certificate handshake, shared by the
+ *         service client and the service provider.
+ */
+
+#ifndef CERT_CRYPTO_H_
+#define CERT_CRYPTO_H_
+
+#include "contiki.h"
+#include "aes-ccm.h"
+#include "sha256.h"
+#include "cert-cbor.h"
+#include "cert-revoke.h"
+
+/* Protected fragment: [sender id (2)][counter (4)][ciphertext][MIC]. */
+#define CERT_CRYPTO_HDR_LEN  6
+#define CERT_CRYPTO_OVERHEAD (CERT_CRYPTO_HDR_LEN + AES_CCM_MIC_LEN)
+
+#ifdef __GNUC__
+#define CERT_CRYPTO_CHECK_RESULT __attribute__((warn_unused_result))
+#else
+#define CERT_CRYPTO_CHECK_RESULT
+#endif
+
+/* Header fields of a protected fragment. They form the nonce, so the MIC
+   covers them; readable before cert_crypto_open(). */
+#define CERT_CRYPTO_SENDER(buf) ((uint16_t)((buf)[0] | ((buf)[1] << 8)))
+#define CERT_CRYPTO_COUNTER(buf) (((uint32_t)(buf)[2] << 24) | \
+                                  ((uint32_t)(buf)[3] << 16) | \
+                                  ((uint32_t)(buf)[4] << 8) | (buf)[5])
+
+/* 1 prints AES-CCM throughput on every verification (make AES_BENCH=1);
+   make crypto-bench measures it without touching the handshake. */
+#ifdef CERT_CRYPTO_CONF_BENCH
+#define CERT_CRYPTO_BENCH CERT_CRYPTO_CONF_BENCH
+#else
+#define CERT_CRYPTO_BENCH 0
+#endif
+
+/* Size of a typical certificate, constant prefix included. */
+#define CERT_LEN 1024
+
+void cert_crypto_init(void);
+
+/*
+ * Starts a certificate hash from the cached midstate of the constant
+ * certificate prefix. Feed the rest with sha256_update().
+ */
+void cert_hash_begin(SHA256_CTX *ctx);
+
+/*
+ * Encrypts the len bytes of plaintext found at buf + CERT_CRYPTO_HDR_LEN
+ * in place, fills in the header and appends the MIC. buf must have room
+ * for len + CERT_CRYPTO_OVERHEAD bytes. Returns the protected length,
+ * or 0 once the counter lease saved in flash cannot be extended; then
+ * nothing may be sent.
+ */
+uint16_t cert_crypto_seal(uint8_t *buf, uint16_t len) CERT_CRYPTO_CHECK_RESULT;
+
+/*
+ * Checks and decrypts a protected fragment of len bytes in place.
+ * Returns the plaintext length (plaintext at buf + CERT_CRYPTO_HDR_LEN),
+ * or -1 if the fragment is truncated or its MIC does not match.
+ */
+int cert_crypto_open(uint8_t *buf, uint16_t len);
+
+/*
+ * Variants for worker threads of the native gateway: no profiling and
+ * no shared mutable state. The caller owns the seal counter and must
+ * never hand out the same value twice. cert_hash_mt() hashes the
+ * constant prefix, cert and the stand-in body up to CERT_LEN.
+ */
+uint16_t cert_crypto_seal_mt(uint8_t *buf, uint16_t len, uint32_t counter);
+int cert_crypto_open_mt(uint8_t *buf, uint16_t len);
+void cert_hash_mt(const uint8_t *cert, uint16_t len, uint8_t digest[SHA256_BLOCK_SIZE]);
+
+/*
+ * Plaintext of fragment index of this node's certificate chain, at most
+ * len bytes; returns the length. With CERT_CBOR the slice of the
+ * compact certificate (0 past its end), otherwise len bytes read from
+ * the certificate store, or the stand-in run of 'A' when the store is
+ * disabled or unreadable.
+ */
+uint16_t cert_fragment_load(uint8_t index, uint8_t *buf, uint16_t len);
+
+#if CERT_CBOR_ENABLED
+/* Fragments of len bytes needed for the compact certificate. */
+uint8_t cert_fragment_count(uint16_t len);
+
+/* Issues this node a new certificate: a new serial, so a new digest. */
+void cert_crypto_rotate(void);
+
+/*
+ * Feeds the next fragment of the peer's compact certificate to d. Once
+ * it is complete the issuer, algorithms and signature are checked.
+ * Returns CERT_CBOR_MORE, CERT_CBOR_DONE (also for fragments after the
+ * certificate) or CERT_CBOR_ERROR.
+ */
+int cert_peer_input(struct cert_cbor_decoder *d, struct cert_cbor *c,
+                    const uint8_t *data, uint16_t len);
+#endif /* CERT_CBOR_ENABLED */
+
+void hash_generation(void);
+void encryption_decryption(void);
+void singnature_varification(void);
+#if CERT_REVOKE_ENABLED
+/*
+ * Checks the peer certificate last accepted by cert_peer_input() against
+ * the revocation filter. Returns CERT_REVOKE_MAYBE on a filter hit, to
+ * be confirmed with the provider, CERT_REVOKE_CLEAR otherwise.
+ */
+int cert_peer_revoke_check(void);
+/* Digest of that certificate, the hash of its to-be-signed part. */
+const uint8_t *cert_verified_digest(void);
+#endif /* CERT_REVOKE_ENABLED */
+void key_generation_exponential(void);
+
+/*
+ * Signature over a Merkle batch root. Stand-in until ECDSA is in: a
+ * SHA-256 MAC of the root under the fragment key, so only a key holder
+ * can sign. cert_root_verify() returns 1 if sig matches root.
+ */
+void cert_root_sign(const uint8_t root[SHA256_BLOCK_SIZE],
+                    uint8_t sig[SHA256_BLOCK_SIZE]);
+int cert_root_verify(const uint8_t root[SHA256_BLOCK_SIZE],
+                     const uint8_t sig[SHA256_BLOCK_SIZE]);
+
+#endif /* CERT_CRYPTO_H_ */
@@ -0,0 +1,633 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Gateway mode of the native provider, see cert-gateway.h.
+ */
+
+#include "contiki.h"
+#include "cert-crypto.h"
+#include "cert-gateway.h"
+#include "host-frontend.h"
+#include "replay-window.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#define MAX_CERT_FLIGHT   18
+#define CERT_FRAGMENT_LEN 128
+
+/* [seqno][flags][collect_view_data_msg], then the fragment. */
+#define MSG_HDR_LEN  (2 + 44)
+/* Flag in the message header of the first fragment of every flight. */
+#define CERT_FLIGHT_START 0x01
+#define MAX_DATAGRAM 320
+
+/* Sessions idle for this long are taken over by new clients. */
+#define SESSION_TIMEOUT_MS 10000
+
+/*
+ * Seal counters of all workers come from one atomic counter in the top
+ * half of the range, disjoint from the main thread's. Like the main
+ * counter it is leased from a file ahead of use, so a restarted gateway
+ * never reuses a nonce, and sealing stops when the range is used up.
+ * A lease is written to a temporary file, synced and renamed over the
+ * old one, so a crash leaves either the old or the new lease on disk.
+ */
+#define SEAL_FILE  "sealctr-gw"
+#define SEAL_TMP   SEAL_FILE ".tmp"
+#define SEAL_FIRST 0x80000000ULL
+#define SEAL_END   0x100000000ULL
+#define SEAL_LEASE (1ULL << 20)
+
+struct job {
+  struct sockaddr_in from;
+  uint16_t len;
+  uint8_t data[MAX_DATAGRAM];
+};
+
+/* Bounded MPMC queue after D. Vyukov: each cell carries a sequence
+   number that tells producers and consumers whose turn it is. */
+struct cell {
+  atomic_size_t seq;
+  struct job job;
+};
+
+static struct cell queue[CERT_GATEWAY_QUEUE];
+static atomic_size_t enqueue_pos, dequeue_pos;
+
+struct session {
+  uint32_t addr;
+  uint16_t port;
+  uint8_t used;
+  uint8_t flight_count;
+  uint64_t last_seen;
+};
+
+/* Same rules as replay-window.c, a sender's window per slot. */
+struct window {
+  uint64_t seen;
+  uint32_t top;
+  uint16_t sender;
+  uint8_t used;
+  uint64_t last_seen;
+};
+
+struct shard {
+  pthread_mutex_t lock;
+  struct session slot[CERT_GATEWAY_SHARD_SESSIONS];
+  struct window window[CERT_GATEWAY_SHARD_SESSIONS];
+};
+
+static struct shard shards[CERT_GATEWAY_SHARDS];
+
+struct worker {
+  pthread_t thread;
+  atomic_ulong fragments;
+  atomic_ulong handshakes;
+};
+
+static struct worker workers[CERT_GATEWAY_WORKERS > 0 ? CERT_GATEWAY_WORKERS : 1];
+static atomic_ulong dropped;
+static atomic_ulong replayed;
+static int sock = -1;
+
+static atomic_ullong seal_next;
+static unsigned long long seal_lease_end;
+static pthread_mutex_t seal_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+/*---------------------------------------------------------------------------*/
+/* Saves end as the first counter a restart may use. Under seal_lock. */
+static int
+seal_lease(unsigned long long end)
+{
+  FILE *f;
+  int ok;
+  int dir;
+
+  f = fopen(SEAL_TMP, "w");
+  if(f == NULL) {
+    return -1;
+  }
+  ok = fprintf(f, "%llu\n", end) > 0;
+  ok = fflush(f) == 0 && ok;
+  ok = fsync(fileno(f)) == 0 && ok;
+  ok = fclose(f) == 0 && ok;
+  if(!ok || rename(SEAL_TMP, SEAL_FILE) < 0) {
+    return -1;
+  }
+  /* Make the rename itself durable. */
+  dir = open(".", O_RDONLY);
+  if(dir >= 0) {
+    fsync(dir);
+    close(dir);
+  }
+  seal_lease_end = end;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+seal_init(void)
+{
+  unsigned long long first;
+  FILE *f;
+
+  first = SEAL_FIRST;
+  f = fopen(SEAL_FILE, "r");
+  if(f != NULL) {
+    if(fscanf(f, "%llu", &first) != 1 || first < SEAL_FIRST) {
+      /* Restarting from SEAL_FIRST would reuse spent nonces. */
+      fprintf(stderr, "gateway: %s is damaged, refusing to seal\n",
+              SEAL_FILE);
+      exit(1);
+    }
+    fclose(f);
+  } else if(errno != ENOENT) {
+    perror("gateway: " SEAL_FILE);
+    exit(1);
+  }
+  atomic_init(&seal_next, first);
+  if(first >= SEAL_END ||
+     seal_lease(first + SEAL_LEASE < SEAL_END ? first + SEAL_LEASE : SEAL_END) < 0) {
+    printf("gateway: cannot lease seal counters, replies disabled\n");
+    seal_lease_end = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* A never used seal counter for any worker, or -1 when none is left. */
+static long long
+seal_counter(void)
+{
+  unsigned long long c;
+  unsigned long long end;
+  int ok;
+
+  c = atomic_fetch_add(&seal_next, 1);
+  if(c >= SEAL_END) {
+    return -1;
+  }
+  ok = 1;
+  pthread_mutex_lock(&seal_lock);
+  if(c >= seal_lease_end) {
+    end = c + SEAL_LEASE < SEAL_END ? c + SEAL_LEASE : SEAL_END;
+    ok = seal_lease_end != 0 && seal_lease(end) == 0;
+  }
+  pthread_mutex_unlock(&seal_lock);
+  return ok ? (long long)c : -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_init(void)
+{
+  size_t i;
+
+  for(i = 0; i < CERT_GATEWAY_QUEUE; i++) {
+    atomic_init(&queue[i].seq, i);
+  }
+  atomic_init(&enqueue_pos, 0);
+  atomic_init(&dequeue_pos, 0);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns a free cell to fill in, or NULL if the queue is full. */
+static struct cell *
+queue_claim(void)
+{
+  struct cell *c;
+  size_t pos, seq;
+  intptr_t diff;
+
+  pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+  while(1) {
+    c = &queue[pos & (CERT_GATEWAY_QUEUE - 1)];
+    seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+    diff = (intptr_t)seq - (intptr_t)pos;
+    if(diff == 0) {
+      if(atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1,
+                                               memory_order_relaxed,
+                                               memory_order_relaxed)) {
+        return c;
+      }
+    } else if(diff < 0) {
+      return NULL;
+    } else {
+      pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_publish(struct cell *c)
+{
+  size_t seq = atomic_load_explicit(&c->seq, memory_order_relaxed);
+  atomic_store_explicit(&c->seq, seq + 1, memory_order_release);
+}
+/*---------------------------------------------------------------------------*/
+/* Copies the next job out, returns 0 if the queue is empty. */
+static int
+queue_pop(struct job *job)
+{
+  struct cell *c;
+  size_t pos, seq;
+  intptr_t diff;
+
+  pos = atomic_load_explicit(&dequeue_pos, memory_order_relaxed);
+  while(1) {
+    c = &queue[pos & (CERT_GATEWAY_QUEUE - 1)];
+    seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+    diff = (intptr_t)seq - (intptr_t)(pos + 1);
+    if(diff == 0) {
+      if(atomic_compare_exchange_weak_explicit(&dequeue_pos, &pos, pos + 1,
+                                               memory_order_relaxed,
+                                               memory_order_relaxed)) {
+        break;
+      }
+    } else if(diff < 0) {
+      return 0;
+    } else {
+      pos = atomic_load_explicit(&dequeue_pos, memory_order_relaxed);
+    }
+  }
+  memcpy(&job->from, &c->job.from, sizeof(job->from));
+  job->len = c->job.len;
+  memcpy(job->data, c->job.data, job->len);
+  atomic_store_explicit(&c->seq, pos + CERT_GATEWAY_QUEUE, memory_order_release);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static struct shard *
+shard_of(uint32_t addr, uint16_t port)
+{
+  uint32_t h = (addr ^ ((uint32_t)port << 16) ^ port) * 2654435761UL;
+  return &shards[(h >> 16) % CERT_GATEWAY_SHARDS];
+}
+#if REPLAY_WINDOW_ENABLED
+/*---------------------------------------------------------------------------*/
+static struct shard *
+shard_of_sender(uint16_t sender)
+{
+  return &shards[((sender * 2654435761UL) >> 16) % CERT_GATEWAY_SHARDS];
+}
+/*---------------------------------------------------------------------------*/
+/* The window of sender, or with take a new one in place of the least
+   recently used. Under the shard lock. */
+static struct window *
+window_find(struct shard *sh, uint16_t sender, int take)
+{
+  struct window *w, *oldest;
+  int i;
+
+  oldest = NULL;
+  for(i = 0; i < CERT_GATEWAY_SHARD_SESSIONS; i++) {
+    w = &sh->window[i];
+    if(w->used && w->sender == sender) {
+      return w;
+    }
+    if(oldest == NULL || !w->used ||
+       (oldest->used && w->last_seen < oldest->last_seen)) {
+      oldest = w;
+    }
+  }
+  if(!take) {
+    return NULL;
+  }
+  memset(oldest, 0, sizeof(*oldest));
+  oldest->used = 1;
+  oldest->sender = sender;
+  return oldest;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * 1 if counter may be new from sender. With mark, which comes after the
+ * MIC, the counter is also recorded, and the check is repeated under
+ * the same lock, so two workers cannot both accept a duplicate.
+ */
+static int
+replay_step(uint16_t sender, uint32_t counter, int mark)
+{
+  struct shard *sh;
+  struct window *w;
+  int32_t diff;
+  int fresh;
+
+  sh = shard_of_sender(sender);
+  pthread_mutex_lock(&sh->lock);
+  w = window_find(sh, sender, mark);
+  fresh = 1;
+  if(w != NULL && w->used && w->seen != 0) {
+    diff = (int32_t)(counter - w->top);
+    if(diff <= 0 && (-diff >= REPLAY_WINDOW_BITS ||
+                     (w->seen & ((uint64_t)1 << -diff)))) {
+      fresh = 0;
+    }
+  }
+  if(fresh && mark) {
+    diff = w->seen == 0 ? 1 : (int32_t)(counter - w->top);
+    if(diff > 0) {
+      w->seen = diff < REPLAY_WINDOW_BITS ? (w->seen << diff) | 1 : 1;
+      w->top = counter;
+    } else {
+      w->seen |= (uint64_t)1 << -diff;
+    }
+    w->last_seen = now_ms();
+  }
+  pthread_mutex_unlock(&sh->lock);
+  if(!fresh) {
+    atomic_fetch_add_explicit(&replayed, 1, memory_order_relaxed);
+  }
+  return fresh;
+}
+#endif /* REPLAY_WINDOW_ENABLED */
+/*---------------------------------------------------------------------------*/
+/*
+ * Advances the flight of the client at addr:port by one fragment and
+ * returns the new fragment count; start restarts it. Same policy as
+ * session_lookup() in cert-service-provider.c: a new client takes a
+ * free slot, else the least recently active one.
+ */
+static uint8_t
+session_step(uint32_t addr, uint16_t port, int start)
+{
+  struct shard *sh;
+  struct session *s, *oldest;
+  uint64_t now;
+  uint8_t count;
+  int i;
+
+  sh = shard_of(addr, port);
+  now = now_ms();
+  pthread_mutex_lock(&sh->lock);
+  oldest = NULL;
+  for(i = 0; i < CERT_GATEWAY_SHARD_SESSIONS; i++) {
+    s = &sh->slot[i];
+    if(s->used && s->addr == addr && s->port == port) {
+      break;
+    }
+    if(oldest == NULL || !s->used ||
+       (oldest->used && s->last_seen < oldest->last_seen)) {
+      oldest = s;
+    }
+    s = NULL;
+  }
+  if(s == NULL) {
+    s = oldest;
+    s->used = 1;
+    s->addr = addr;
+    s->port = port;
+    s->flight_count = 0;
+  } else if(start || now - s->last_seen > SESSION_TIMEOUT_MS) {
+    s->flight_count = 0;
+  }
+  s->last_seen = now;
+  count = ++s->flight_count;
+  if(count == MAX_CERT_FLIGHT) {
+    s->used = 0;
+  }
+  pthread_mutex_unlock(&sh->lock);
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/* Thread-safe counterpart of singnature_varification(). */
+static void
+verify_certificate(const uint8_t *cert, uint16_t len)
+{
+  uint8_t digest[SHA256_BLOCK_SIZE];
+
+  cert_hash_mt(cert, len, digest);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_job(struct worker *w, struct job *job)
+{
+  uint8_t reply[MSG_HDR_LEN + CERT_FRAGMENT_LEN + CERT_CRYPTO_OVERHEAD];
+  uint8_t *frag;
+  uint16_t len;
+  int plain_len;
+  long long counter;
+
+  if(job->len < MSG_HDR_LEN + CERT_CRYPTO_HDR_LEN) {
+    return;
+  }
+  frag = job->data + MSG_HDR_LEN;
+#if REPLAY_WINDOW_ENABLED
+  /* Duplicates and stale fragments go before any crypto. */
+  if(!replay_step(CERT_CRYPTO_SENDER(frag), CERT_CRYPTO_COUNTER(frag), 0)) {
+    return;
+  }
+#endif /* REPLAY_WINDOW_ENABLED */
+  if((plain_len = cert_crypto_open_mt(frag, job->len - MSG_HDR_LEN)) < 0) {
+    return;
+  }
+#if REPLAY_WINDOW_ENABLED
+  if(!replay_step(CERT_CRYPTO_SENDER(frag), CERT_CRYPTO_COUNTER(frag), 1)) {
+    return;
+  }
+#endif /* REPLAY_WINDOW_ENABLED */
+  atomic_fetch_add_explicit(&w->fragments, 1, memory_order_relaxed);
+
+  switch(session_step(job->from.sin_addr.s_addr, job->from.sin_port,
+                      job->data[1] & CERT_FLIGHT_START)) {
+  case 1:
+    verify_certificate(job->data + MSG_HDR_LEN + CERT_CRYPTO_HDR_LEN,
+                       plain_len);
+    /* key_generation_exponential() has nothing left to do once compiled. */
+    break;
+  case MAX_CERT_FLIGHT:
+    atomic_fetch_add_explicit(&w->handshakes, 1, memory_order_relaxed);
+    break;
+  }
+
+  /* Host peers get no mesh statistics in the collect-view header. */
+  memset(reply, 0, MSG_HDR_LEN);
+  reply[0] = job->data[0];
+  frag = reply + MSG_HDR_LEN;
+  memset(frag + CERT_CRYPTO_HDR_LEN, 'A', CERT_FRAGMENT_LEN);
+  frag[CERT_CRYPTO_HDR_LEN + CERT_FRAGMENT_LEN - 1] = 0;
+  if((counter = seal_counter()) < 0) {
+    atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+    return;
+  }
+  len = cert_crypto_seal_mt(frag, CERT_FRAGMENT_LEN, (uint32_t)counter);
+  sendto(sock, reply, MSG_HDR_LEN + len, 0,
+         (struct sockaddr *)&job->from, sizeof(job->from));
+}
+/*---------------------------------------------------------------------------*/
+static void *
+worker_loop(void *arg)
+{
+  struct worker *w = arg;
+  struct job job;
+  struct timespec nap = { 0, 50000 };
+  unsigned idle = 0;
+
+  while(1) {
+    if(queue_pop(&job)) {
+      handle_job(w, &job);
+      idle = 0;
+    } else if(++idle < 256) {
+      sched_yield();
+    } else {
+      nanosleep(&nap, NULL);
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(void)
+{
+  static unsigned long last_fragments, last_handshakes;
+  unsigned long fragments = 0, handshakes = 0;
+  int i;
+
+  for(i = 0; i < CERT_GATEWAY_WORKERS; i++) {
+    fragments += atomic_load(&workers[i].fragments);
+    handshakes += atomic_load(&workers[i].handshakes);
+  }
+  if(fragments != last_fragments) {
+    printf("gateway: [%lu] handshakes/s [%lu] fragments/s [%lu] dropped "
+           "[%lu] replayed\n",
+           handshakes - last_handshakes, fragments - last_fragments,
+           (unsigned long)atomic_load(&dropped),
+           (unsigned long)atomic_load(&replayed));
+  }
+  last_fragments = fragments;
+  last_handshakes = handshakes;
+}
+/*---------------------------------------------------------------------------*/
+static void *
+frontend_loop(void *arg)
+{
+  struct epoll_event ev;
+  struct cell *c;
+  socklen_t from_len;
+  uint64_t next_report;
+  ssize_t n;
+  int epfd;
+
+  epfd = epoll_create1(0);
+  ev.events = EPOLLIN;
+  ev.data.fd = sock;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &ev);
+  next_report = now_ms() + 1000;
+
+  while(1) {
+    epoll_wait(epfd, &ev, 1, 100);
+    while(1) {
+      c = queue_claim();
+      if(c == NULL) {
+        /* Workers are saturated: shed load like a full radio queue. */
+        uint8_t discard[MAX_DATAGRAM];
+        if(recv(sock, discard, sizeof(discard), MSG_DONTWAIT) <= 0) {
+          break;
+        }
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        continue;
+      }
+      from_len = sizeof(c->job.from);
+      n = recvfrom(sock, c->job.data, MAX_DATAGRAM, MSG_DONTWAIT,
+                   (struct sockaddr *)&c->job.from, &from_len);
+      c->job.len = n > 0 ? n : 0;
+      /* A claimed cell must be published; an empty job is skipped. */
+      queue_publish(c);
+      if(n <= 0) {
+        break;
+      }
+    }
+    if(now_ms() >= next_report) {
+      report();
+      next_report += 1000;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_gateway_init(void)
+{
+  struct sockaddr_in sin;
+  pthread_t frontend;
+  uint16_t port;
+  int size = 4 << 20;
+  int i;
+
+  port = host_frontend_port();
+  if(port == 0) {
+    return;
+  }
+  queue_init();
+  for(i = 0; i < CERT_GATEWAY_SHARDS; i++) {
+    pthread_mutex_init(&shards[i].lock, NULL);
+  }
+
+  sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if(sock < 0) {
+    perror("gateway: socket");
+    exit(1);
+  }
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(port);
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(bind(sock, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+    perror("gateway: bind");
+    printf("gateway: port %u taken, mesh only\n", port);
+    close(sock);
+    sock = -1;
+    return;
+  }
+
+  seal_init();
+  for(i = 0; i < CERT_GATEWAY_WORKERS; i++) {
+    pthread_create(&workers[i].thread, NULL, worker_loop, &workers[i]);
+  }
+  pthread_create(&frontend, NULL, frontend_loop, NULL);
+  printf("gateway: %u workers on 127.0.0.1:%u\n",
+         CERT_GATEWAY_WORKERS, port);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,78 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Gateway mode of the native provider: host clients are served
+ *         by a pool of worker threads instead of udp_server_process.
+ *
+ *         One epoll thread reads the host UDP socket and hands each
+ *         datagram to the workers through a bounded lock-free MPMC
+ *         queue. Workers drop replays against per-sender windows (as in
+ *         replay-window.h, sharded by sender id), check the MIC, track
+ *         the flight in a sharded session table, verify the certificate
+ *         and send the sealed reply on the same socket. Mesh clients
+ *         keep going through the Contiki stack.
+ *
+ *         Enabled with make TARGET=native GATEWAY=<workers>.
+ */
+
+#ifndef CERT_GATEWAY_H_
+#define CERT_GATEWAY_H_
+
+/* Worker threads, 0 leaves host clients to host-frontend.c. */
+#ifdef CERT_GATEWAY_CONF_WORKERS
+#define CERT_GATEWAY_WORKERS CERT_GATEWAY_CONF_WORKERS
+#else
+#define CERT_GATEWAY_WORKERS 0
+#endif
+
+/* Datagrams waiting for a worker, a power of two. */
+#ifdef CERT_GATEWAY_CONF_QUEUE
+#define CERT_GATEWAY_QUEUE CERT_GATEWAY_CONF_QUEUE
+#else
+#define CERT_GATEWAY_QUEUE 4096
+#endif
+
+/* The session table is CERT_GATEWAY_SHARDS locks over as many slots
+   each; the replay windows use the same shards and as many senders. */
+#ifdef CERT_GATEWAY_CONF_SHARDS
+#define CERT_GATEWAY_SHARDS CERT_GATEWAY_CONF_SHARDS
+#else
+#define CERT_GATEWAY_SHARDS 64
+#endif
+
+#ifdef CERT_GATEWAY_CONF_SHARD_SESSIONS
+#define CERT_GATEWAY_SHARD_SESSIONS CERT_GATEWAY_CONF_SHARD_SESSIONS
+#else
+#define CERT_GATEWAY_SHARD_SESSIONS 64
+#endif
+
+/* Starts the front end and the workers on HOST_FRONTEND_PORT. */
+void cert_gateway_init(void);
+
+#endif /* CERT_GATEWAY_H_ */
@@ -0,0 +1,212 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Certificate revocation filter.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cert-revoke.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if CERT_REVOKE_ENABLED
+
+#if CERT_REVOKE_BITS % 8 != 0 || CERT_REVOKE_BITS > 32768
+#error "CERT_REVOKE_BITS must be a multiple of 8, at most 32768"
+#endif
+#if CERT_REVOKE_HASHES < 1 || CERT_REVOKE_HASHES > SHA256_BLOCK_SIZE / 2
+#error "CERT_REVOKE_HASHES must be 1 to 16"
+#endif
+
+#define FILTER_FILE "revoke"
+#define LIST_FILE   "revlist"
+
+#define DELTA_HDR_LEN   4
+#define DELTA_ENTRY_LEN 3
+
+static uint16_t version;
+static uint8_t filter[CERT_REVOKE_BITS / 8];
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get16(const uint8_t *p)
+{
+  return (p[0] << 8) | p[1];
+}
+/*---------------------------------------------------------------------------*/
+static int
+save(void)
+{
+  int fd;
+  int ok;
+
+  cfs_remove(FILTER_FILE);
+  fd = cfs_open(FILTER_FILE, CFS_WRITE);
+  if(fd < 0) {
+    return -1;
+  }
+  ok = cfs_write(fd, &version, sizeof(version)) == sizeof(version) &&
+    cfs_write(fd, filter, sizeof(filter)) == sizeof(filter);
+  cfs_close(fd);
+  return ok ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_revoke_init(void)
+{
+  int fd;
+
+  fd = cfs_open(FILTER_FILE, CFS_READ);
+  if(fd < 0 ||
+     cfs_read(fd, &version, sizeof(version)) != sizeof(version) ||
+     cfs_read(fd, filter, sizeof(filter)) != sizeof(filter)) {
+    /* Missing, or saved with another CERT_REVOKE_BITS. */
+    version = 0;
+    memset(filter, 0, sizeof(filter));
+  }
+  if(fd >= 0) {
+    cfs_close(fd);
+  }
+  cert_revoke_stats();
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_revoke_check(const uint8_t digest[SHA256_BLOCK_SIZE])
+{
+  uint16_t bit;
+  int i;
+
+  for(i = 0; i < CERT_REVOKE_HASHES; i++) {
+    bit = get16(digest + 2 * i) % CERT_REVOKE_BITS;
+    if((filter[bit >> 3] & (1 << (bit & 7))) == 0) {
+      return CERT_REVOKE_CLEAR;
+    }
+  }
+  return CERT_REVOKE_MAYBE;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_revoke_apply(const uint8_t *delta, uint16_t len)
+{
+  uint16_t from;
+  uint16_t i;
+
+  if(len < DELTA_HDR_LEN || (len - DELTA_HDR_LEN) % DELTA_ENTRY_LEN != 0) {
+    return -1;
+  }
+  from = get16(delta);
+  if(from != 0 && from != version) {
+    return -1;
+  }
+  /* All offsets first, a bad delta leaves the filter untouched. */
+  for(i = DELTA_HDR_LEN; i < len; i += DELTA_ENTRY_LEN) {
+    if(get16(delta + i) >= sizeof(filter)) {
+      return -1;
+    }
+  }
+  if(from == 0) {
+    memset(filter, 0, sizeof(filter));
+  }
+  for(i = DELTA_HDR_LEN; i < len; i += DELTA_ENTRY_LEN) {
+    filter[get16(delta + i)] = delta[i + 2];
+  }
+  version = get16(delta + 2);
+  return save();
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+cert_revoke_version(void)
+{
+  return version;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_revoke_add(const uint8_t digest[SHA256_BLOCK_SIZE])
+{
+  int fd;
+  int ok;
+
+  if(cert_revoke_listed(digest)) {
+    return 0;
+  }
+  fd = cfs_open(LIST_FILE, CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    return -1;
+  }
+  ok = cfs_write(fd, digest, SHA256_BLOCK_SIZE) == SHA256_BLOCK_SIZE;
+  cfs_close(fd);
+  return ok ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_revoke_listed(const uint8_t digest[SHA256_BLOCK_SIZE])
+{
+  uint8_t entry[SHA256_BLOCK_SIZE];
+  int fd;
+  int found;
+
+  fd = cfs_open(LIST_FILE, CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  found = 0;
+  while(!found && cfs_read(fd, entry, sizeof(entry)) == sizeof(entry)) {
+    found = memcmp(entry, digest, sizeof(entry)) == 0;
+  }
+  cfs_close(fd);
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_revoke_stats(void)
+{
+  unsigned long ppm;
+  uint16_t set;
+  uint16_t i;
+  uint8_t b;
+  int k;
+
+  set = 0;
+  for(i = 0; i < sizeof(filter); i++) {
+    for(b = filter[i]; b != 0; b &= b - 1) {
+      set++;
+    }
+  }
+  /* A random digest hits with (set / m)^k. */
+  ppm = 1000000UL;
+  for(k = 0; k < CERT_REVOKE_HASHES; k++) {
+    ppm = ppm * (set * 1000UL / CERT_REVOKE_BITS) / 1000;
+  }
+  printf("revoke: version [%u] [%u] bits k [%u] set [%u] fp [%lu] ppm\n",
+         version, CERT_REVOKE_BITS, CERT_REVOKE_HASHES, set, ppm);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* CERT_REVOKE_ENABLED */
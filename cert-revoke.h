@@ -0,0 +1,114 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Certificate revocation filter: a Bloom filter over the SHA-256
+ *         digests of revoked certificates, kept in a file (Coffee on the
+ *         sky) and loaded into RAM at boot like the store index. A check
+ *         is CERT_REVOKE_HASHES bit probes, each index a 16 bit word of
+ *         the digest modulo CERT_REVOKE_BITS, so no extra hashing.
+ *
+ *         A hit may be a false positive and is confirmed with the root
+ *         provider, which keeps the exact list (cert_revoke_add()), or
+ *         with another provider when the root's own certificate is under
+ *         check; never with the provider under check. With
+ *         n revoked certificates the false positive rate is about
+ *
+ *           (1 - e^(-k n / m))^k   for m = CERT_REVOKE_BITS, k = HASHES
+ *
+ *         m = 1024 (128 B), k = 4: 0.1 % at n = 50, 1 % at n = 100.
+ *         m = 2048 (256 B), k = 4: 0.1 % at n = 100.
+ *
+ *         Updates are deltas against a filter version:
+ *
+ *           [from (2)][to (2)] { [byte offset (2)][new value (1)] }*
+ *
+ *         big endian. A delta applies only on top of version from, and
+ *         from = 0 starts over from an empty filter; pieces of a longer
+ *         update repeat from = to. Entries carry the new byte value, so
+ *         a repeated delta is harmless. tools/revoke-filter.py builds
+ *         them from a list of digests.
+ */
+
+#ifndef CERT_REVOKE_H_
+#define CERT_REVOKE_H_
+
+#include "contiki.h"
+#include "sha256.h"
+
+#ifdef CERT_REVOKE_CONF_ENABLED
+#define CERT_REVOKE_ENABLED CERT_REVOKE_CONF_ENABLED
+#else
+#define CERT_REVOKE_ENABLED 0
+#endif
+
+/* Filter size in bits, a multiple of 8 and at most 32768. */
+#ifdef CERT_REVOKE_CONF_BITS
+#define CERT_REVOKE_BITS CERT_REVOKE_CONF_BITS
+#else
+#define CERT_REVOKE_BITS 1024
+#endif
+
+/* Probes per check, at most 16 (one per digest word). */
+#ifdef CERT_REVOKE_CONF_HASHES
+#define CERT_REVOKE_HASHES CERT_REVOKE_CONF_HASHES
+#else
+#define CERT_REVOKE_HASHES 4
+#endif
+
+/* Status queries go to the provider on their own ports:
+     query   [digest (32)]
+     answer  [digest (32)][status (1)][counter of the query (4)] */
+#define CERT_REVOKE_CLIENT_PORT   8776
+#define CERT_REVOKE_PROVIDER_PORT 5689
+#define CERT_REVOKE_ANSWER_LEN    (SHA256_BLOCK_SIZE + 1 + 4)
+
+/* Result of a check or a provider answer. */
+#define CERT_REVOKE_CLEAR   0
+#define CERT_REVOKE_MAYBE   1
+#define CERT_REVOKE_REVOKED 2
+
+void cert_revoke_init(void);
+
+/* CERT_REVOKE_MAYBE if every probe hits, CERT_REVOKE_CLEAR otherwise. */
+int cert_revoke_check(const uint8_t digest[SHA256_BLOCK_SIZE]);
+
+/* Applies a delta and saves the filter. Returns 0, or -1 if it is
+   malformed or does not apply to the current version. */
+int cert_revoke_apply(const uint8_t *delta, uint16_t len);
+
+uint16_t cert_revoke_version(void);
+
+/* Exact list, on the provider: appends a digest / looks it up. */
+int cert_revoke_add(const uint8_t digest[SHA256_BLOCK_SIZE]);
+int cert_revoke_listed(const uint8_t digest[SHA256_BLOCK_SIZE]);
+
+/* Version, fill and estimated false positive rate on one line. */
+void cert_revoke_stats(void);
+
+#endif /* CERT_REVOKE_H_ */
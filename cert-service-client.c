@@ -32,17 +32,28 @@
 #include "net/ipv6/uip-ds6.h"
 #include "net/ip/uip-udp-packet.h"
 #include "net/rpl/rpl.h"
+#include "net/netstack.h"
 #include "dev/serial-line.h"
 
 #if CONTIKI_TARGET_Z1
 #include "dev/uart0.h"
-#else
+#elif !CONTIKI_TARGET_NATIVE
 #include "dev/uart1.h"
 #endif
 #include "collect-common.h"
 #include "collect-view.h"
 
-#include "sha256.h"
+#include "cert-crypto.h"
+#include "cert-revoke.h"
+#include "merkle.h"
+#include "replay-window.h"
+#include "provider-select.h"
+#include "cert-cache.h"
+#include "cert-trickle.h"
+#include "cert-admit.h"
+#include "auth-prof.h"
+#include "ram-mon.h"
+#include "scratch.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -61,8 +72,96 @@
 static struct uip_udp_conn *client_conn;
 static uip_ipaddr_t server_ipaddr;
 
+#define CERT_FRAGMENT_LEN 128
+#if CERT_CBOR_ENABLED
+/* As many fragments as the compact certificate needs, plus one for the
+   batch proof; the provider uses the same profile. */
+#define MAX_CERT_FLIGHT (cert_fragment_count(CERT_FRAGMENT_LEN) + MERKLE_BATCH_ENABLED)
+#else /* CERT_CBOR_ENABLED */
 #define MAX_CERT_FLIGHT 18
+#endif /* CERT_CBOR_ENABLED */
+/* Flag in the message header of the first fragment of every flight. */
+#define CERT_FLIGHT_START 0x01
 static uint8_t cert_flight_count = 0;
+/* UDP payload bytes of the current flight, each way. */
+static uint16_t flight_tx_bytes, flight_rx_bytes;
+
+#if CERT_CBOR_ENABLED
+static struct cert_cbor peer_cert;
+static struct cert_cbor_decoder peer_dec;
+#endif /* CERT_CBOR_ENABLED */
+
+#if CERT_CACHE_ENABLED
+/* Set while the provider certificate is pulled through the cache, and
+   once that failed. */
+static uint8_t fetch_pending;
+static uint8_t fetch_failed;
+#endif /* CERT_CACHE_ENABLED */
+/* Set from the first send of a flight until it ends, while the time and
+   energy windows are open. */
+static uint8_t flight_tracked;
+/* Who answered the last fragment of the flight, and from how far. */
+static uint16_t flight_provider;
+static uint8_t flight_hops;
+
+#if CERT_REVOKE_ENABLED
+static struct uip_udp_conn *revoke_conn;
+/* A filter hit yet to be answered; the flight waits for it. */
+static uint8_t revoke_pending;
+static struct ctimer revoke_timer;
+/* Who was asked, and the seal counter of the query, echoed back. */
+static uip_ipaddr_t revoke_to;
+static uint32_t revoke_counter;
+#ifdef CERT_CONF_REVOKE_TIMEOUT
+#define CERT_REVOKE_TIMEOUT CERT_CONF_REVOKE_TIMEOUT
+#else
+#define CERT_REVOKE_TIMEOUT (CLOCK_SECOND * 10)
+#endif
+#endif /* CERT_REVOKE_ENABLED */
+
+/* Idle time between the end of a flight and the next one. */
+#ifdef CERT_CONF_FLIGHT_PAUSE
+#define CERT_FLIGHT_PAUSE CERT_CONF_FLIGHT_PAUSE
+#else
+#define CERT_FLIGHT_PAUSE (CLOCK_SECOND * 120)
+#endif
+/* Not a busy wait: routers keep forwarding and answering the cache. */
+static struct ctimer pause_timer;
+
+#if PROVIDER_SELECT_ENABLED
+/* A provider that leaves a fragment unanswered this long is given up. */
+#ifdef CERT_CONF_REPLY_TIMEOUT
+#define CERT_REPLY_TIMEOUT CERT_CONF_REPLY_TIMEOUT
+#else
+#define CERT_REPLY_TIMEOUT (CLOCK_SECOND * 30)
+#endif
+static struct ctimer reply_timer;
+#endif /* PROVIDER_SELECT_ENABLED */
+
+/* Keep the radio on while a flight runs instead of paying a ContikiMAC
+   wake-up strobe for every fragment (make RDC_BURST=1). */
+#ifdef CERT_CONF_RDC_BURST
+#define CERT_RDC_BURST CERT_CONF_RDC_BURST
+#else
+#define CERT_RDC_BURST 0
+#endif
+
+#if CERT_RDC_BURST
+/* Back to duty cycling when the provider stays silent this long. */
+#ifdef CERT_CONF_RDC_BURST_IDLE
+#define CERT_RDC_BURST_IDLE CERT_CONF_RDC_BURST_IDLE
+#else
+#define CERT_RDC_BURST_IDLE (CLOCK_SECOND * 10)
+#endif
+static struct ctimer burst_timer;
+static uint8_t burst_active;
+static clock_time_t burst_start;
+#endif /* CERT_RDC_BURST */
+
+#if MERKLE_BATCH_ENABLED
+/* H(own id || first fragment), the leaf the provider puts in its batch. */
+static uint8_t transcript_leaf[MERKLE_HASH_LEN];
+#endif /* MERKLE_BATCH_ENABLED */
 
 static unsigned long rstart_time = 0; 
 static unsigned long rend_time = 0;
@@ -141,7 +240,7 @@ energy_tracking_stop (void)
   cpu_energy_stop = energest_type_time(ENERGEST_TYPE_CPU) - cpu_energy_start;
   lpm_energy_stop = energest_type_time(ENERGEST_TYPE_LPM) - lpm_energy_start;
   transmit_energy_stop = energest_type_time(ENERGEST_TYPE_TRANSMIT) - transmit_energy_start;
-  listen_energy_stop = energest_type_time(ENERGEST_TYPE_LISTEN) - transmit_energy_start;
+  listen_energy_stop = energest_type_time(ENERGEST_TYPE_LISTEN) - listen_energy_start;
 
   energy_consumed =  (cpu_current* cpu_energy_stop);
   energy_consumed = energy_consumed + (lpm_current * lpm_energy_stop); 
@@ -149,6 +248,10 @@ energy_tracking_stop (void)
   energy_consumed = energy_consumed + (listen_current * listen_energy_stop);
   energy_consumed = energy_consumed* volt;
   energy_consumed = energy_consumed / RTIMER_SECOND;
+  /* Radio on time shows the strobing against listen window trade. */
+  printf("radio [%lu] ms listen [%lu] ms transmit\n",
+         listen_energy_stop * 125 / (RTIMER_SECOND / 8),
+         transmit_energy_stop * 125 / (RTIMER_SECOND / 8));
   printf("energy consumption [%lu] mJ\n", energy_consumed); 
   
 }
@@ -173,94 +276,484 @@ time_tracking_stop (void)
   printf("relasped_time [%lu] ticks, rlatency [%lu] sec\n", relasped_time, relasped_time/RTIMER_SECOND ); // RTIMER_ARCH_SECOND
   printf("celasped_time [%lu] ticks, clatency [%lu] sec\n", celasped_time, celasped_time/CLOCK_SECOND );
 }
+#if CERT_RDC_BURST
 /*---------------------------------------------------------------------------*/
-void 
-hash_generation(void)
+static void
+burst_end(void)
 {
-  uint8_t buffer[1024]; /* certificate buffer*/
-  int i =0;
-  int hash_output =1;
-  //BYTE text2[] = {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"};
- // BYTE hash2[SHA256_BLOCK_SIZE] = {0x24,0x8d,0x6a,0x61,0xd2,0x06,0x38,0xb8,0xe5,0xc0,0x26,0x93,0x0c,0x3e,0x60,0x39,
-                                  // 0xa3,0x3c,0xe4,0x59,0x64,0xff,0x21,0x67,0xf6,0xec,0xed,0xd4,0x19,0xdb,0x06,0xc1};
-  BYTE buf[SHA256_BLOCK_SIZE];
-  SHA256_CTX ctx;
-  int idx;
-  int pass = 1;
-
-  /*sha256_init(&ctx);
-  sha256_update(&ctx, text2, strlen(text2));
-  sha256_final(&ctx, buf);
-  pass = pass && !memcmp(hash2, buf, SHA256_BLOCK_SIZE);*/
-
-  printf("SHA test resutl: [%lu]", pass);
-
-
-  memset(buffer, 'A', 1024);
-  for(i=0; i<1024; i++) {
-    hash_output = hash_output ^ buffer[i];
+  if(!burst_active) {
+    return;
+  }
+  ctimer_stop(&burst_timer);
+  burst_active = 0;
+  NETSTACK_RDC.on();
+  printf("rdc burst [%lu] ms\n",
+         (unsigned long)(clock_time() - burst_start) * 1000 / CLOCK_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+static void
+burst_timeout(void *ptr)
+{
+  printf("rdc burst: no reply at fragment [%u], duty cycling again\n",
+         cert_flight_count);
+  burst_end();
+}
+/*---------------------------------------------------------------------------*/
+/* Radio on from the first fragment out until the flight is over. Every
+   reply pushes the safety timeout back. */
+static void
+burst_begin(void)
+{
+  if(!burst_active) {
+    burst_active = 1;
+    burst_start = clock_time();
+    NETSTACK_RDC.off(1);
   }
+  ctimer_set(&burst_timer, CERT_RDC_BURST_IDLE, burst_timeout, NULL);
+}
+#endif /* CERT_RDC_BURST */
+static void flight_abort(const char *why);
+static void flight_done(void);
+#if CERT_REVOKE_ENABLED
+/*---------------------------------------------------------------------------*/
+static void
+revoke_timeout(void *ptr)
+{
+  revoke_pending = 0;
+  flight_abort("no revocation answer");
+}
+/*---------------------------------------------------------------------------*/
+/* The root answers queries, unless its own certificate is under check;
+   then another provider. 0 if there is nobody but the one under check. */
+static int
+revoke_responder(uip_ipaddr_t *to)
+{
+#if PROVIDER_SELECT_ENABLED
+  const uip_ipaddr_t *other;
+#endif /* PROVIDER_SELECT_ENABLED */
 
+  uip_ip6addr(to, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+  if(!uip_ipaddr_cmp(to, &server_ipaddr)) {
+    return 1;
+  }
+#if PROVIDER_SELECT_ENABLED
+  other = provider_select_other(&server_ipaddr);
+  if(other != NULL) {
+    uip_ipaddr_copy(to, other);
+    return 1;
+  }
+#endif /* PROVIDER_SELECT_ENABLED */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* A filter hit: ask whether the certificate is revoked. */
+static void
+revoke_query(void)
+{
+  scratch_mark_t mark;
+  uint16_t len;
+  uint8_t *buf;
+
+  mark = scratch_mark();
+  buf = scratch_alloc(SHA256_BLOCK_SIZE + CERT_CRYPTO_OVERHEAD);
+  if(!revoke_responder(&revoke_to)) {
+    printf("revoke: filter hit, nobody but the provider to ask\n");
+  } else if(buf != NULL) {
+    memcpy(buf + CERT_CRYPTO_HDR_LEN, cert_verified_digest(), SHA256_BLOCK_SIZE);
+    len = cert_crypto_seal(buf, SHA256_BLOCK_SIZE);
+    if(len != 0) {
+      revoke_counter = CERT_CRYPTO_COUNTER(buf);
+      uip_udp_packet_sendto(revoke_conn, buf, len, &revoke_to,
+                            UIP_HTONS(CERT_REVOKE_PROVIDER_PORT));
+      printf("revoke: filter hit, asking [%u]\n",
+             revoke_to.u8[15] + (revoke_to.u8[14] << 8));
+    }
+  }
+  scratch_release(mark);
+  /* Unsent or unanswered, the flight fails closed. */
+  revoke_pending = 1;
+  ctimer_set(&revoke_timer, CERT_REVOKE_TIMEOUT, revoke_timeout, NULL);
+}
+/*---------------------------------------------------------------------------*/
+/* Only the answer to the pending query counts: from whom it was asked,
+   about the certificate under check, echoing the query's counter. */
+static void
+revoke_answer(void)
+{
+  uint8_t *buf;
+  uint8_t *plain;
+  int len;
 
+  if(!uip_newdata()) {
+    return;
+  }
+  buf = (uint8_t *)uip_appdata;
+  if(!revoke_pending || uip_datalen() < CERT_CRYPTO_HDR_LEN ||
+     !uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &revoke_to)) {
+    printf("revoke: dropping answer\n");
+    return;
+  }
+#if REPLAY_WINDOW_ENABLED
+  if(!replay_window_check(CERT_CRYPTO_SENDER(buf), CERT_CRYPTO_COUNTER(buf))) {
+    return;
+  }
+#endif /* REPLAY_WINDOW_ENABLED */
+  len = cert_crypto_open(buf, uip_datalen());
+  if(len < 0) {
+    printf("revoke: dropping answer, bad MIC\n");
+    return;
+  }
+#if REPLAY_WINDOW_ENABLED
+  replay_window_update(CERT_CRYPTO_SENDER(buf), CERT_CRYPTO_COUNTER(buf));
+#endif /* REPLAY_WINDOW_ENABLED */
+  plain = buf + CERT_CRYPTO_HDR_LEN;
+  if(len != CERT_REVOKE_ANSWER_LEN ||
+     memcmp(plain, cert_verified_digest(), SHA256_BLOCK_SIZE) != 0 ||
+     CERT_CRYPTO_COUNTER(plain + SHA256_BLOCK_SIZE + 1) != revoke_counter) {
+    printf("revoke: dropping answer\n");
+    return;
+  }
+  revoke_pending = 0;
+  ctimer_stop(&revoke_timer);
+  if(plain[SHA256_BLOCK_SIZE] == CERT_REVOKE_REVOKED) {
+#if PROVIDER_SELECT_ENABLED
+    /* The next flight goes to another provider. */
+    provider_select_failed(&server_ipaddr);
+#endif /* PROVIDER_SELECT_ENABLED */
+    flight_abort("provider certificate revoked");
+  } else {
+    printf("revoke: false positive\n");
+    flight_done();
+  }
 }
+#endif /* CERT_REVOKE_ENABLED */
 /*---------------------------------------------------------------------------*/
-void 
-encryption_decryption(void)
+static void
+verify_peer(void)
+{
+  singnature_varification();
+}
+#if CERT_CBOR_ENABLED
+/*---------------------------------------------------------------------------*/
+/* Feeds a fragment of the provider certificate to the decoder. A
+   rejected certificate sticks in peer_dec.error for flight_done(). */
+static int
+peer_input(const uint8_t *data, uint16_t len)
+{
+  int ret;
+#if CERT_REVOKE_ENABLED
+  uint8_t complete;
+
+  complete = peer_dec.item == CERT_CBOR_ITEMS;
+#endif /* CERT_REVOKE_ENABLED */
+  ret = cert_peer_input(&peer_dec, &peer_cert, data, len);
+#if CERT_REVOKE_ENABLED
+  /* The certificate just completed: check its digest once. */
+  if(ret == CERT_CBOR_DONE && !complete &&
+     cert_peer_revoke_check() == CERT_REVOKE_MAYBE) {
+    revoke_query();
+  }
+#endif /* CERT_REVOKE_ENABLED */
+  return ret;
+}
+#endif /* CERT_CBOR_ENABLED */
+#if MERKLE_BATCH_ENABLED
+/*---------------------------------------------------------------------------*/
+/* Returns 1 if the proof puts our transcript under a root the provider
+   signed. */
+static int
+batch_verify(const uint8_t *plain, int len)
 {
-  hash_generation();
+  struct merkle_proof proof;
+  rtimer_clock_t start;
+
+  start = RTIMER_NOW();
+  if(len < 1 || plain[0] != MERKLE_PROOF_TAG ||
+     !merkle_proof_read(&proof, plain + 1, len - 1) ||
+     len != 1 + MERKLE_PROOF_LEN(proof.depth) + MERKLE_HASH_LEN ||
+     !merkle_verify(transcript_leaf, &proof)) {
+    printf("merkle proof FAILED\n");
+    return 0;
+  }
+  /* One signature check over the batch root. */
+  verify_peer();
+  if(!cert_root_verify(proof.root, plain + 1 + MERKLE_PROOF_LEN(proof.depth))) {
+    printf("merkle root signature FAILED\n");
+    return 0;
+  }
+  printf("merkle verify depth [%u] in [%lu] ticks\n", proof.depth,
+         (unsigned long)(rtimer_clock_t)(RTIMER_NOW() - start));
+  return 1;
+}
+#endif /* MERKLE_BATCH_ENABLED */
+#if CERT_ADMIT_ENABLED
+/*---------------------------------------------------------------------------*/
+/* The provider turned the flight away, start it again when it says. */
+static void
+admit_busy(void)
+{
+  uint16_t delay;
 
+  delay = cert_admit_input(&server_ipaddr);
+  /* Only an answer to an outstanding first fragment, not one arriving
+     between flights, or two flights would run at once. */
+  if(delay == 0 || !flight_tracked || cert_flight_count != 0) {
+    return;
+  }
+  ctimer_stop(&pause_timer);
+#if PROVIDER_SELECT_ENABLED
+  ctimer_stop(&reply_timer);
+#endif /* PROVIDER_SELECT_ENABLED */
+  auth_prof_end(AUTH_PROF_WAIT);
+#if CERT_RDC_BURST
+  /* No point listening through the backoff. */
+  burst_end();
+#endif /* CERT_RDC_BURST */
+  cert_admit_backoff(delay, collect_common_send);
 }
+#endif /* CERT_ADMIT_ENABLED */
 /*---------------------------------------------------------------------------*/
-void 
-singnature_varification(void)
+static void
+pause_over(void *ptr)
 {
-  hash_generation();
-  encryption_decryption();
+  collect_common_send();
 }
 /*---------------------------------------------------------------------------*/
-void 
-key_generation_exponential(void)
-{
-  unsigned long a =65300 ;
-  unsigned long b=65300;
-  unsigned long key;
-  unsigned long i, j;
-  for (i =0; i < a; i++) {
-    for (j =0; j< b; j++) {
-      key = key + a;
-    }
+static void
+flight_next(void)
+{
+  ctimer_set(&pause_timer, CERT_FLIGHT_PAUSE, pause_over, NULL);
+}
+/*---------------------------------------------------------------------------*/
+/* Drops the current flight without success lines for the benchmark;
+   the profile closes it, so a restart opens a fresh window. */
+static void
+flight_reset(void)
+{
+  cert_flight_count = 0;
+  flight_tracked = 0;
+#if CERT_REVOKE_ENABLED
+  revoke_pending = 0;
+  ctimer_stop(&revoke_timer);
+#endif /* CERT_REVOKE_ENABLED */
+#if CERT_RDC_BURST
+  burst_end();
+#endif /* CERT_RDC_BURST */
+#if PROVIDER_SELECT_ENABLED
+  ctimer_stop(&reply_timer);
+#endif /* PROVIDER_SELECT_ENABLED */
+  flight_tx_bytes = 0;
+  flight_rx_bytes = 0;
+  auth_prof_end(AUTH_PROF_FLIGHT);
+}
+/*---------------------------------------------------------------------------*/
+/* The provider was not authenticated: no session key, and the next
+   flight after the usual pause. */
+static void
+flight_abort(const char *why)
+{
+  printf("flight aborted: %s\n", why);
+  flight_reset();
+  flight_next();
+}
+#if PROVIDER_SELECT_ENABLED
+/*---------------------------------------------------------------------------*/
+/* Restarts the flight with the next best provider. */
+static void
+reply_timeout(void *ptr)
+{
+  printf("provider [%u] silent at fragment [%u], failing over\n",
+         server_ipaddr.u8[15] + (server_ipaddr.u8[14] << 8), cert_flight_count);
+  provider_select_failed(&server_ipaddr);
+  auth_prof_end(AUTH_PROF_WAIT);
+  flight_reset();
+  collect_common_send();
+}
+#endif /* PROVIDER_SELECT_ENABLED */
+/*---------------------------------------------------------------------------*/
+static void
+flight_end(void)
+{
+  cert_flight_count = 0;
+#if CERT_RDC_BURST
+  burst_end();
+#endif /* CERT_RDC_BURST */
+  printf("flight bytes [%u] tx [%u] rx\n", flight_tx_bytes, flight_rx_bytes);
+  printf("flight provider [%u] hops [%u]\n", flight_provider, flight_hops);
+  flight_tx_bytes = 0;
+  flight_rx_bytes = 0;
+  time_tracking_stop();
+  energy_tracking_stop();
+  flight_tracked = 0;
+  auth_prof_end(AUTH_PROF_FLIGHT);
+  flight_next();
+}
+/*---------------------------------------------------------------------------*/
+/* Ends the flight once its last fragment is in and neither the
+   certificate fetch nor a revocation query is outstanding. */
+static void
+flight_done(void)
+{
+  if(cert_flight_count != MAX_CERT_FLIGHT) {
+    return;
   }
+#if CERT_CACHE_ENABLED
+  if(fetch_pending) {
+    return;
+  }
+  if(fetch_failed) {
+    flight_abort("certificate fetch failed");
+    return;
+  }
+#endif /* CERT_CACHE_ENABLED */
+#if CERT_REVOKE_ENABLED
+  if(revoke_pending) {
+    return;
+  }
+#endif /* CERT_REVOKE_ENABLED */
+#if CERT_CBOR_ENABLED
+  if(peer_dec.error) {
+    flight_abort("bad certificate");
+    return;
+  }
+#endif /* CERT_CBOR_ENABLED */
+  flight_end();
+}
+#if CERT_CACHE_ENABLED
+/*---------------------------------------------------------------------------*/
+static void
+peer_fragment(const uint8_t *data, uint16_t len)
+{
+#if CERT_CBOR_ENABLED
+  peer_input(data, len);
+#endif /* CERT_CBOR_ENABLED */
 }
 /*---------------------------------------------------------------------------*/
 static void
+peer_fetched(int ok)
+{
+  fetch_pending = 0;
+  if(!ok) {
+    /* Never obtained, never verified: flight_done() aborts the flight. */
+    printf("cache: fetching the provider certificate failed\n");
+    fetch_failed = 1;
+  }
+#if !MERKLE_BATCH_ENABLED
+#if CERT_CBOR_ENABLED
+  else if(!peer_dec.error) {
+#else /* CERT_CBOR_ENABLED */
+  else {
+#endif /* CERT_CBOR_ENABLED */
+    verify_peer();
+  }
+#endif /* !MERKLE_BATCH_ENABLED */
+  flight_done();
+}
+#endif /* CERT_CACHE_ENABLED */
+/*---------------------------------------------------------------------------*/
+static void
 tcpip_handler(void)
 {
   uint8_t *appdata;
   linkaddr_t sender;
   uint8_t seqno;
   uint8_t hops;
+  uint16_t hdr_len;
+  int plain_len;
 
   if(uip_newdata()) {
+    auth_prof_end(AUTH_PROF_WAIT);
     appdata = (uint8_t *)uip_appdata;
     sender.u8[0] = UIP_IP_BUF->srcipaddr.u8[15];
     sender.u8[1] = UIP_IP_BUF->srcipaddr.u8[14];
     seqno = *appdata;
     hops = uip_ds6_if.cur_hop_limit - UIP_IP_BUF->ttl + 1;
+    hdr_len = 2 + sizeof(struct collect_view_data_msg);
+#if PROVIDER_SELECT_ENABLED
+    /* Late replies of a provider the flight failed over from. */
+    if(!uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &server_ipaddr)) {
+      return;
+    }
+#endif /* PROVIDER_SELECT_ENABLED */
+#if REPLAY_WINDOW_ENABLED
+    /* Duplicates and stale replies go before any crypto. */
+    if(uip_datalen() >= hdr_len + CERT_CRYPTO_HDR_LEN &&
+       !replay_window_check(CERT_CRYPTO_SENDER(appdata + hdr_len),
+                            CERT_CRYPTO_COUNTER(appdata + hdr_len))) {
+      return;
+    }
+#endif /* REPLAY_WINDOW_ENABLED */
+    if(uip_datalen() < hdr_len ||
+       (plain_len = cert_crypto_open(appdata + hdr_len, uip_datalen() - hdr_len)) < 0) {
+      printf("dropping fragment from [%u]: bad MIC\n",
+             sender.u8[0] + (sender.u8[1] << 8));
+      return;
+    }
+#if REPLAY_WINDOW_ENABLED
+    replay_window_update(CERT_CRYPTO_SENDER(appdata + hdr_len),
+                         CERT_CRYPTO_COUNTER(appdata + hdr_len));
+#endif /* REPLAY_WINDOW_ENABLED */
+#if CERT_RDC_BURST
+    if(burst_active) {
+      ctimer_set(&burst_timer, CERT_RDC_BURST_IDLE, burst_timeout, NULL);
+    }
+#endif /* CERT_RDC_BURST */
     //collect_common_recv(&sender, seqno, hops, appdata + 2, uip_datalen() - 2-128); // 128 is the size of the payload
 
+    flight_rx_bytes += uip_datalen();
     cert_flight_count = cert_flight_count+ 1 ;
+#if CERT_CBOR_ENABLED
+    if(cert_flight_count == 1) {
+      memset(&peer_dec, 0, sizeof(peer_dec));
+    }
+#if !CERT_CACHE_ENABLED
+    if(peer_input(appdata + hdr_len + CERT_CRYPTO_HDR_LEN,
+                  plain_len) == CERT_CBOR_ERROR) {
+      flight_abort("bad certificate");
+      return;
+    }
+#endif /* !CERT_CACHE_ENABLED */
+#endif /* CERT_CBOR_ENABLED */
     if(cert_flight_count == MAX_CERT_FLIGHT) {
-      cert_flight_count =0;
-      time_tracking_stop();
-      energy_tracking_stop();
-      clock_wait(CLOCK_SECOND * 120) ; /*wait for 120s second and then go ahead*/
-      collect_common_send();
+      flight_provider = sender.u8[0] + (sender.u8[1] << 8);
+      flight_hops = hops;
+#if PROVIDER_SELECT_ENABLED
+      ctimer_stop(&reply_timer);
+#endif /* PROVIDER_SELECT_ENABLED */
+#if MERKLE_BATCH_ENABLED
+      if(!batch_verify(appdata + hdr_len + CERT_CRYPTO_HDR_LEN, plain_len)) {
+        flight_abort("merkle proof");
+        return;
+      }
+      /* Only now is the provider known, so only now the session key. */
+      key_generation_exponential();
+#endif /* MERKLE_BATCH_ENABLED */
+      /* Or peer_fetched() or revoke_answer(), whichever is last. */
+      flight_done();
     } else {
       if (cert_flight_count == 1) { // first packet
-        time_tracking_start();
-        energy_tracking_start();
-        singnature_varification();
+        auth_prof_begin(AUTH_PROF_FLIGHT);
+#if CERT_ADMIT_ENABLED
+        cert_admit_done();
+#endif /* CERT_ADMIT_ENABLED */
+#if CERT_CACHE_ENABLED
+        /* The reply names the certificate, fetch it from the nearest copy. */
+        fetch_failed = 0;
+        if(plain_len == SHA256_BLOCK_SIZE) {
+          fetch_pending = 1;
+          cert_cache_fetch(appdata + hdr_len + CERT_CRYPTO_HDR_LEN,
+                           &UIP_IP_BUF->srcipaddr, peer_fragment, peer_fetched);
+        } else {
+          /* No digest, no certificate to fetch. */
+          fetch_failed = 1;
+        }
+#elif !MERKLE_BATCH_ENABLED
+        /* With batching the signature is checked on the last fragment. */
+        verify_peer();
+#endif /* CERT_CACHE_ENABLED */
+#if !MERKLE_BATCH_ENABLED
         key_generation_exponential();
+#endif /* !MERKLE_BATCH_ENABLED */
         hash_generation();
       }
       collect_common_send();
@@ -276,11 +769,17 @@ collect_common_send(void)
   static uint8_t seqno;
   struct {
     uint8_t seqno;
-    uint8_t for_alignment;
+    uint8_t flags;
     struct collect_view_data_msg msg;
     char payload [256];
-  } msg;
+  } *msg;
   uint16_t packet_size;
+  uint16_t frag_len;
+  uint16_t sealed_len;
+  scratch_mark_t mark;
+#if MERKLE_BATCH_ENABLED
+  SHA256_CTX *ctx;
+#endif /* MERKLE_BATCH_ENABLED */
 
   /* struct collect_neighbor *n; */
   uint16_t parent_etx;
@@ -295,13 +794,24 @@ collect_common_send(void)
     /* Not setup yet */
     return;
   }
-  memset(&msg, 0, sizeof(msg));
+  auth_prof_begin(AUTH_PROF_SEND);
+  mark = scratch_mark();
+  msg = scratch_alloc(sizeof(*msg));
+  if(msg == NULL) {
+    auth_prof_end(AUTH_PROF_SEND);
+    return;
+  }
+  memset(msg, 0, sizeof(*msg));
   seqno++;
   if(seqno == 0) {
     /* Wrap to 128 to identify restarts */
     seqno = 128;
   }
-  msg.seqno = seqno;
+  msg->seqno = seqno;
+  if(cert_flight_count == 0) {
+    /* Tells the provider to drop what it kept of an earlier attempt. */
+    msg->flags = CERT_FLIGHT_START;
+  }
 
   linkaddr_copy(&parent, &linkaddr_null);
   parent_etx = 0;
@@ -330,17 +840,58 @@ collect_common_send(void)
   }
 
   /* packet size without payload*/
-  packet_size = sizeof(msg) - sizeof(msg.payload);
+  packet_size = sizeof(*msg) - sizeof(msg->payload);
 
 
-  memset(msg.payload, 'A', 128);
-  msg.payload[127] = 0; 
-  packet_size = packet_size  + 128;
+#if PROVIDER_SELECT_ENABLED
+  /* The provider stays fixed for the whole flight. */
+  if(cert_flight_count == 0) {
+    uip_ipaddr_copy(&server_ipaddr, provider_select_current());
+  }
+#endif /* PROVIDER_SELECT_ENABLED */
+  if(cert_flight_count == 0 && !flight_tracked) {
+    /* From the first send in every mode, so the first round trip, and
+       with RDC_BURST its listen time, is part of the flight. */
+    flight_tracked = 1;
+    time_tracking_start();
+    energy_tracking_start();
+  }
+#if CERT_RDC_BURST
+  if(cert_flight_count == 0) {
+    burst_begin();
+  }
+#endif /* CERT_RDC_BURST */
+  frag_len = cert_fragment_load(cert_flight_count,
+                                (uint8_t *)msg->payload + CERT_CRYPTO_HDR_LEN,
+                                CERT_FRAGMENT_LEN);
+#if MERKLE_BATCH_ENABLED
+  if(cert_flight_count == 0 && (ctx = scratch_alloc(sizeof(*ctx))) != NULL) {
+    merkle_leaf_begin(ctx);
+    sha256_update(ctx, &linkaddr_node_addr.u8[LINKADDR_SIZE - 2], 2);
+    sha256_update(ctx, (uint8_t *)msg->payload + CERT_CRYPTO_HDR_LEN, frag_len);
+    sha256_final(ctx, transcript_leaf);
+  }
+#endif /* MERKLE_BATCH_ENABLED */
+  sealed_len = cert_crypto_seal((uint8_t *)msg->payload, frag_len);
+  if(sealed_len == 0) {
+    scratch_release(mark);
+    auth_prof_end(AUTH_PROF_SEND);
+    return;
+  }
+  packet_size = packet_size + sealed_len;
+  flight_tx_bytes += packet_size;
  
   /* num_neighbors = collect_neighbor_list_num(&tc.neighbor_list); */
-  collect_view_construct_message(&msg.msg, &parent,parent_etx, rtmetric, num_neighbors, beacon_interval);
+  collect_view_construct_message(&msg->msg, &parent,parent_etx, rtmetric, num_neighbors, beacon_interval);
   //uip_udp_packet_sendto(client_conn, &msg, sizeof(msg), &server_ipaddr, UIP_HTONS(UDP_SERVER_PORT));
-  uip_udp_packet_sendto(client_conn, &msg,packet_size, &server_ipaddr, UIP_HTONS(UDP_SERVER_PORT));
+  uip_udp_packet_sendto(client_conn, msg,packet_size, &server_ipaddr, UIP_HTONS(UDP_SERVER_PORT));
+  scratch_release(mark);
+#if PROVIDER_SELECT_ENABLED
+  ctimer_set(&reply_timer, CERT_REPLY_TIMEOUT, reply_timeout, NULL);
+#endif /* PROVIDER_SELECT_ENABLED */
+  auth_prof_end(AUTH_PROF_SEND);
+  /* Radio TX and listen until the reply shows up land in this phase. */
+  auth_prof_begin(AUTH_PROF_WAIT);
 
  
 
@@ -355,7 +906,7 @@ collect_common_net_init(void)
 {
 #if CONTIKI_TARGET_Z1
   uart0_set_input(serial_line_input_byte);
-#else
+#elif !CONTIKI_TARGET_NATIVE
   uart1_set_input(serial_line_input_byte);
 #endif
   serial_line_init();
@@ -394,7 +945,7 @@ set_global_address(void)
   uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
   uip_ds6_addr_add(&ipaddr, 0, ADDR_AUTOCONF);
 
-  /* set server address */
+  /* set server address, the root provider when several are selected from */
   uip_ip6addr(&server_ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
 
 }
@@ -406,6 +957,13 @@ PROCESS_THREAD(udp_client_process, ev, data)
   PROCESS_PAUSE();
 
   set_global_address();
+  cert_crypto_init();
+#if CERT_CACHE_ENABLED
+  cert_cache_init();
+#endif /* CERT_CACHE_ENABLED */
+#if CERT_TRICKLE_ENABLED
+  cert_trickle_init(0);
+#endif /* CERT_TRICKLE_ENABLED */
 
   PRINTF("UDP client process started\n");
 
@@ -418,12 +976,49 @@ PROCESS_THREAD(udp_client_process, ev, data)
   PRINTF("Created a connection with the server ");
   PRINT6ADDR(&client_conn->ripaddr);
   PRINTF(" local/remote port %u/%u\n",UIP_HTONS(client_conn->lport), UIP_HTONS(client_conn->rport));
+#if CERT_REVOKE_ENABLED
+  revoke_conn = udp_new(NULL, UIP_HTONS(CERT_REVOKE_PROVIDER_PORT), NULL);
+  udp_bind(revoke_conn, UIP_HTONS(CERT_REVOKE_CLIENT_PORT));
+#endif /* CERT_REVOKE_ENABLED */
+#if PROVIDER_SELECT_ENABLED
+  provider_select_client_init();
+#endif /* PROVIDER_SELECT_ENABLED */
+#if CERT_ADMIT_ENABLED
+  cert_admit_client_init();
+#endif /* CERT_ADMIT_ENABLED */
 
   while(1) {
     PROCESS_YIELD();
+    ram_mon_process(NULL);
     if(ev == tcpip_event) {
+#if CERT_REVOKE_ENABLED
+      if(uip_udp_conn == revoke_conn) {
+        revoke_answer();
+      } else
+#endif /* CERT_REVOKE_ENABLED */
+#if PROVIDER_SELECT_ENABLED
+      if(uip_udp_conn == provider_select_conn()) {
+        provider_select_input();
+      } else
+#endif /* PROVIDER_SELECT_ENABLED */
+#if CERT_CACHE_ENABLED
+      if(uip_udp_conn == cert_cache_conn()) {
+        cert_cache_input();
+      } else
+#endif /* CERT_CACHE_ENABLED */
+#if CERT_TRICKLE_ENABLED
+      if(uip_udp_conn == cert_trickle_conn()) {
+        cert_trickle_input();
+      } else
+#endif /* CERT_TRICKLE_ENABLED */
+#if CERT_ADMIT_ENABLED
+      if(uip_udp_conn == cert_admit_conn()) {
+        admit_busy();
+      } else
+#endif /* CERT_ADMIT_ENABLED */
       tcpip_handler();
     }
+    ram_mon_process(PROCESS_CURRENT());
   }
 
   PROCESS_END();
@@ -39,7 +39,7 @@
 #include "dev/serial-line.h"
 #if CONTIKI_TARGET_Z1
 #include "dev/uart0.h"
-#else
+#elif !CONTIKI_TARGET_NATIVE
 #include "dev/uart1.h"
 #endif
 #include <stdio.h>
@@ -48,6 +48,21 @@
 #include <ctype.h>
 #include "collect-common.h"
 #include "collect-view.h"
+#include "cert-crypto.h"
+#include "cert-revoke.h"
+#include "merkle.h"
+#include "replay-window.h"
+#include "provider-select.h"
+#include "cert-cache.h"
+#include "cert-trickle.h"
+#include "cert-admit.h"
+#include "batch-verify.h"
+#include "sha256-mb.h"
+#include "auth-prof.h"
+#include "ram-mon.h"
+#include "scratch.h"
+#include "host-frontend.h"
+#include "cert-gateway.h"
 
 #define DEBUG DEBUG_PRINT
 #include "net/ip/uip-debug.h"
@@ -58,9 +73,64 @@
 #define UDP_SERVER_PORT 5688
 
 static struct uip_udp_conn *server_conn;
-
+#if CERT_REVOKE_ENABLED
+/* Clients confirm revocation filter hits on this one. */
+static struct uip_udp_conn *revoke_conn;
+#endif /* CERT_REVOKE_ENABLED */
+
+#define CERT_FRAGMENT_LEN 128
+#if CERT_CBOR_ENABLED
+/* As many fragments as the compact certificate needs, plus one for the
+   batch proof; clients use the same profile. */
+#define MAX_CERT_FLIGHT (cert_fragment_count(CERT_FRAGMENT_LEN) + MERKLE_BATCH_ENABLED)
+#else /* CERT_CBOR_ENABLED */
 #define MAX_CERT_FLIGHT 18
-static uint8_t cert_flight_count = 0;
+#endif /* CERT_CBOR_ENABLED */
+/* Flag in the message header of the first fragment of every flight. */
+#define CERT_FLIGHT_START 0x01
+
+/* Clients that can be in the middle of a flight at the same time. */
+#ifdef CERT_CONF_MAX_SESSIONS
+#define CERT_MAX_SESSIONS CERT_CONF_MAX_SESSIONS
+#else
+#define CERT_MAX_SESSIONS 4
+#endif
+
+#define LEAF_NONE     0
+#define LEAF_PENDING  1 /* waiting for the next batch */
+#define LEAF_IN_BATCH 2
+
+struct cert_session {
+  uip_ipaddr_t peer;
+  clock_time_t last_seen;
+  uint8_t used;
+  uint8_t flight_count;
+  uint8_t verify_pending;
+#if MERKLE_BATCH_ENABLED
+  uint8_t leaf_state;
+  uint8_t leaf_index;
+  uint8_t leaf[MERKLE_HASH_LEN];
+#endif /* MERKLE_BATCH_ENABLED */
+#if CERT_CBOR_ENABLED
+  /* The client's certificate, decoded as its fragments arrive. */
+  struct cert_cbor_decoder peer_dec;
+  struct cert_cbor peer_cert;
+#endif /* CERT_CBOR_ENABLED */
+};
+static struct cert_session sessions[CERT_MAX_SESSIONS];
+/* Flight bytes over the provider's links, each way. */
+static unsigned long link_tx_bytes, link_rx_bytes;
+RAM_POOL(session_pool, "sessions", CERT_MAX_SESSIONS,
+         sizeof(struct cert_session));
+
+#if MERKLE_BATCH_ENABLED
+static struct merkle_batch batch;
+/* Signature over the root of the sealed batch. */
+static uint8_t batch_sig[MERKLE_HASH_LEN];
+/* Sessions of the current batch that have not received their proof. */
+static uint8_t batch_members;
+static struct ctimer batch_timer;
+#endif /* MERKLE_BATCH_ENABLED */
 
 PROCESS(udp_server_process, "UDP server process");
 AUTOSTART_PROCESSES(&udp_server_process,&collect_common_process);
@@ -104,66 +174,211 @@ collect_common_net_init(void)
 {
 #if CONTIKI_TARGET_Z1
   uart0_set_input(serial_line_input_byte);
-#else
+#elif !CONTIKI_TARGET_NATIVE
   uart1_set_input(serial_line_input_byte);
 #endif
   serial_line_init();
 
   PRINTF("I am service provider!\n");
 }
+#if MERKLE_BATCH_ENABLED
+/*---------------------------------------------------------------------------*/
+static void
+batch_seal(void)
+{
+  rtimer_clock_t start;
+
+  ctimer_stop(&batch_timer);
+  start = RTIMER_NOW();
+  merkle_batch_seal(&batch);
+  /* One signature covers every transcript in the batch. */
+  singnature_varification();
+  cert_root_sign(batch.nodes[1], batch_sig);
+  printf("merkle batch [%u] leaves sealed in [%lu] ticks\n", batch.count,
+         (unsigned long)(rtimer_clock_t)(RTIMER_NOW() - start));
+}
+/*---------------------------------------------------------------------------*/
+static void
+batch_timeout(void *ptr)
+{
+  if(!batch.sealed && batch.count > 0) {
+    batch_seal();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+batch_join(struct cert_session *s)
+{
+  int index;
+
+  index = merkle_batch_add(&batch, s->leaf);
+  if(index < 0) {
+    s->leaf_state = LEAF_PENDING;
+    return;
+  }
+  s->leaf_state = LEAF_IN_BATCH;
+  s->leaf_index = index;
+  if(batch_members++ == 0) {
+    ctimer_set(&batch_timer, MERKLE_BATCH_WINDOW, batch_timeout, NULL);
+  }
+  if(batch.count == MERKLE_MAX_LEAVES) {
+    batch_seal();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+batch_restart(void)
+{
+  int i;
+
+  ctimer_stop(&batch_timer);
+  merkle_batch_reset(&batch);
+  batch_members = 0;
+  for(i = 0; i < CERT_MAX_SESSIONS; i++) {
+    if(sessions[i].used && sessions[i].leaf_state == LEAF_PENDING) {
+      batch_join(&sessions[i]);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+batch_leave(struct cert_session *s)
+{
+  if(s->leaf_state == LEAF_IN_BATCH && --batch_members == 0) {
+    batch_restart();
+  }
+  s->leaf_state = LEAF_NONE;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+batch_write_proof(struct cert_session *s, uint8_t *buf)
+{
+  struct merkle_proof proof;
+  uint16_t len;
+
+  if(s->leaf_state == LEAF_IN_BATCH) {
+    if(!batch.sealed) {
+      batch_seal();
+    }
+    merkle_batch_proof(&batch, s->leaf_index, &proof);
+    memcpy(buf + 1 + MERKLE_PROOF_LEN(proof.depth), batch_sig, MERKLE_HASH_LEN);
+  } else {
+    /* Missed every batch: sign this transcript on its own. */
+    proof.index = 0;
+    proof.depth = 0;
+    memcpy(proof.root, s->leaf, MERKLE_HASH_LEN);
+    singnature_varification();
+    cert_root_sign(proof.root, buf + 1 + MERKLE_PROOF_LEN(0));
+  }
+  buf[0] = MERKLE_PROOF_TAG;
+  len = 1 + merkle_proof_write(&proof, buf + 1) + MERKLE_HASH_LEN;
+  batch_leave(s);
+  return len;
+}
+#endif /* MERKLE_BATCH_ENABLED */
 /*---------------------------------------------------------------------------*/
-void 
-hash_generation(void)
+static void
+session_release(struct cert_session *s)
 {
-  uint8_t buffer[1024]; /* certificate buffer*/
-  int i =0;
-  int hash_output =1;
-  memset(buffer, 'A', 1024);
-  for(i=0; i<1024; i++) {
-    hash_output = hash_output ^ buffer[i];
+#if MERKLE_BATCH_ENABLED
+  batch_leave(s);
+#endif /* MERKLE_BATCH_ENABLED */
+#if BATCH_VERIFY_ENABLED
+  if(s->verify_pending) {
+    batch_verify_cancel(s);
   }
+#endif /* BATCH_VERIFY_ENABLED */
+  s->used = 0;
+  ram_pool_set(&session_pool, session_pool.used - 1);
 }
 /*---------------------------------------------------------------------------*/
-void 
-encryption_decryption(void)
+/* The session of peer, or NULL. */
+static struct cert_session *
+session_find(const uip_ipaddr_t *peer)
 {
-  hash_generation();
+  int i;
 
+  for(i = 0; i < CERT_MAX_SESSIONS; i++) {
+    if(sessions[i].used && uip_ipaddr_cmp(&sessions[i].peer, peer)) {
+      return &sessions[i];
+    }
+  }
+  return NULL;
 }
 /*---------------------------------------------------------------------------*/
-void 
-singnature_varification(void)
+static struct cert_session *
+session_lookup(const uip_ipaddr_t *peer)
 {
-  hash_generation();
-  encryption_decryption();
+  struct cert_session *s;
+  struct cert_session *oldest;
+  int i;
+
+  s = session_find(peer);
+  if(s != NULL) {
+    s->last_seen = clock_time();
+    return s;
+  }
+  oldest = NULL;
+  for(i = 0; i < CERT_MAX_SESSIONS; i++) {
+    s = &sessions[i];
+    if(oldest == NULL || !s->used ||
+       (oldest->used && s->last_seen < oldest->last_seen)) {
+      oldest = s;
+    }
+  }
+
+  /* New client: take a free slot or evict the least recently active one. */
+  if(oldest->used) {
+    session_release(oldest);
+  }
+  memset(oldest, 0, sizeof(*oldest));
+  uip_ipaddr_copy(&oldest->peer, peer);
+  oldest->used = 1;
+  oldest->last_seen = clock_time();
+  ram_pool_set(&session_pool, session_pool.used + 1);
+  return oldest;
 }
+#if CERT_ADMIT_ENABLED
 /*---------------------------------------------------------------------------*/
-void 
-key_generation_exponential(void)
+/* 1 if peer may start a new flight, otherwise it was told to come back. */
+static int
+session_admit(const uip_ipaddr_t *peer)
 {
-  unsigned long a =65300 ;
-  unsigned long b=65300;
-  unsigned long key;
-  unsigned long i, j;
-  for (i =0; i < a; i++) {
-    for (j =0; j< b; j++) {
-      key = key + a;
+  int slot_free;
+  int i;
+
+#if HOST_FRONTEND_PORT
+  /* The load generator measures raw throughput. */
+  if(host_frontend_is_peer(peer)) {
+    return 1;
+  }
+#endif /* HOST_FRONTEND_PORT */
+  slot_free = 0;
+  for(i = 0; i < CERT_MAX_SESSIONS; i++) {
+    if(!sessions[i].used ||
+       (!sessions[i].verify_pending &&
+        clock_time() - sessions[i].last_seen > CERT_ADMIT_IDLE)) {
+      slot_free = 1;
     }
   }
+  return cert_admit_request(peer, slot_free);
 }
+#endif /* CERT_ADMIT_ENABLED */
 /*---------------------------------------------------------------------------*/
 static void
-send_reply_to_peer(void)
+send_reply_to_peer(struct cert_session *s)
 {
-   char buf[140];
   static uint8_t seqno;
   struct {
     uint8_t seqno;
-    uint8_t for_alignment;
+    uint8_t flags;
     struct collect_view_data_msg msg;
     char payload [256];
-  } msg;
+  } *msg;
   uint16_t packet_size;
+  uint16_t frag_len;
+  uint16_t sealed_len;
+  scratch_mark_t mark;
 
   /* struct collect_neighbor *n; */
   uint16_t parent_etx;
@@ -179,13 +394,20 @@ send_reply_to_peer(void)
     /* Not setup yet */
     return;
   }
-  memset(&msg, 0, sizeof(msg));
+  auth_prof_begin(AUTH_PROF_SEND);
+  mark = scratch_mark();
+  msg = scratch_alloc(sizeof(*msg));
+  if(msg == NULL) {
+    auth_prof_end(AUTH_PROF_SEND);
+    return;
+  }
+  memset(msg, 0, sizeof(*msg));
   seqno++;
   if(seqno == 0) {
     /* Wrap to 128 to identify restarts */
     seqno = 128;
   }
-  msg.seqno = seqno;
+  msg->seqno = seqno;
 
   linkaddr_copy(&parent, &linkaddr_null);
   parent_etx = 0;
@@ -213,61 +435,266 @@ send_reply_to_peer(void)
     num_neighbors = 0;
   }
 
-   uip_ipaddr_copy(&server_conn->ripaddr, &UIP_IP_BUF->srcipaddr);
+  /* Replies to deferred checks are sent outside of tcpip_handler(). */
+  if(s != NULL) {
+    uip_ipaddr_copy(&server_conn->ripaddr, &s->peer);
+  } else {
+    uip_ipaddr_copy(&server_conn->ripaddr, &UIP_IP_BUF->srcipaddr);
+  }
    //PRINTF("Service provider -> service client IP: ");
   // PRINT6ADDR(&server_conn->ripaddr);
   // PRINTF("  Port: %u", UIP_HTONS(server_conn->rport));
   // PRINTF("\n");
 
    /* packet size without payload*/
-  packet_size = sizeof(msg) - sizeof(msg.payload);
-  memset(msg.payload, 'A', 128);
-  msg.payload[127] = 0; 
-  packet_size = packet_size  + 128;
+  packet_size = sizeof(*msg) - sizeof(msg->payload);
+#if MERKLE_BATCH_ENABLED
+  if(s != NULL && s->flight_count == MAX_CERT_FLIGHT) {
+    /* Last fragment of the flight carries the batch proof. */
+    sealed_len = cert_crypto_seal((uint8_t *)msg->payload,
+                                  batch_write_proof(s, (uint8_t *)msg->payload + CERT_CRYPTO_HDR_LEN));
+  } else
+#endif /* MERKLE_BATCH_ENABLED */
+  {
+#if CERT_CACHE_ENABLED
+    /* Clients fetch the certificate itself through the cache. */
+    memcpy((uint8_t *)msg->payload + CERT_CRYPTO_HDR_LEN,
+           cert_cache_own_digest(), SHA256_BLOCK_SIZE);
+    frag_len = SHA256_BLOCK_SIZE;
+#else /* CERT_CACHE_ENABLED */
+    frag_len = cert_fragment_load(s != NULL ? s->flight_count - 1 : 0,
+                                  (uint8_t *)msg->payload + CERT_CRYPTO_HDR_LEN,
+                                  CERT_FRAGMENT_LEN);
+#endif /* CERT_CACHE_ENABLED */
+    sealed_len = cert_crypto_seal((uint8_t *)msg->payload, frag_len);
+  }
+  if(sealed_len == 0) {
+    scratch_release(mark);
+    auth_prof_end(AUTH_PROF_SEND);
+    return;
+  }
+  packet_size = packet_size + sealed_len;
+  link_tx_bytes += packet_size;
  
 
   /* num_neighbors = collect_neighbor_list_num(&tc.neighbor_list); */
-  collect_view_construct_message(&msg.msg, &parent, parent_etx, rtmetric, num_neighbors, beacon_interval);
-  uip_udp_packet_send(server_conn,&msg, packet_size);
+  collect_view_construct_message(&msg->msg, &parent, parent_etx, rtmetric, num_neighbors, beacon_interval);
+#if HOST_FRONTEND_PORT
+  if(s != NULL && host_frontend_is_peer(&s->peer)) {
+    host_frontend_send(&s->peer, msg, packet_size);
+  } else
+#endif /* HOST_FRONTEND_PORT */
+  {
+    uip_udp_packet_send(server_conn, msg, packet_size);
+  }
+  scratch_release(mark);
+  auth_prof_end(AUTH_PROF_SEND);
   
   /* Restore server connection to allow data from any node */
   //memset(&server_conn->ripaddr, 0, sizeof(server_conn->ripaddr));
 
 }
+#if BATCH_VERIFY_ENABLED
 /*---------------------------------------------------------------------------*/
 static void
-tcpip_handler(void)
+verify_done(void *owner, int ok)
+{
+  struct cert_session *s = owner;
+
+  s->verify_pending = 0;
+  if(!ok) {
+    printf("certificate of client rejected\n");
+    session_release(s);
+    return;
+  }
+  key_generation_exponential();
+  send_reply_to_peer(s);
+}
+#endif /* BATCH_VERIFY_ENABLED */
+/*---------------------------------------------------------------------------*/
+/* One flight fragment from peer, received over the mesh or the host. */
+static void
+handle_fragment(const uip_ipaddr_t *peer, uint8_t *appdata, uint16_t len,
+                uint8_t hops)
 {
-  uint8_t *appdata;
   linkaddr_t sender;
   uint8_t seqno;
-  uint8_t hops;
-
-  if(uip_newdata()) {
-    appdata = (uint8_t *)uip_appdata;
-    sender.u8[0] = UIP_IP_BUF->srcipaddr.u8[15];
-    sender.u8[1] = UIP_IP_BUF->srcipaddr.u8[14];
-    seqno = *appdata;
-    hops = uip_ds6_if.cur_hop_limit - UIP_IP_BUF->ttl + 1;
-    collect_common_recv(&sender, seqno, hops, appdata + 2, uip_datalen() - 2-128); //128 is the side of the payload
-    //PRINTF("Message from service-client: %s \n", appdata+2+sizeof(struct collect_view_data_msg) );
-    cert_flight_count = cert_flight_count+ 1 ;
-    if(cert_flight_count == MAX_CERT_FLIGHT) {
-      cert_flight_count =0;
-
-      //wait for some secon and then go ahead
-       send_reply_to_peer();
-    } else {
-       if (cert_flight_count == 1) { // first packet
-        singnature_varification();
-        key_generation_exponential();
+  uint16_t hdr_len;
+  int plain_len;
+  struct cert_session *s;
+#if MERKLE_BATCH_ENABLED
+  scratch_mark_t mark;
+  SHA256_CTX *ctx;
+#endif /* MERKLE_BATCH_ENABLED */
+
+  sender.u8[0] = peer->u8[15];
+  sender.u8[1] = peer->u8[14];
+  seqno = *appdata;
+  hdr_len = 2 + sizeof(struct collect_view_data_msg);
+#if REPLAY_WINDOW_ENABLED
+  /* Duplicates and stale fragments go before any crypto, and before a
+     replay could open a session. */
+  if(len >= hdr_len + CERT_CRYPTO_HDR_LEN &&
+     !replay_window_check(CERT_CRYPTO_SENDER(appdata + hdr_len),
+                          CERT_CRYPTO_COUNTER(appdata + hdr_len))) {
+    return;
+  }
+#endif /* REPLAY_WINDOW_ENABLED */
+  if(len < hdr_len ||
+     (plain_len = cert_crypto_open(appdata + hdr_len, len - hdr_len)) < 0) {
+    printf("dropping fragment from [%u]: bad MIC\n",
+           sender.u8[0] + (sender.u8[1] << 8));
+    return;
+  }
+#if REPLAY_WINDOW_ENABLED
+  replay_window_update(CERT_CRYPTO_SENDER(appdata + hdr_len),
+                       CERT_CRYPTO_COUNTER(appdata + hdr_len));
+#endif /* REPLAY_WINDOW_ENABLED */
+#if CERT_ADMIT_ENABLED
+  /* A new flight needs a token and a free slot, no session is evicted. */
+  if(session_find(peer) == NULL && !session_admit(peer)) {
+    return;
+  }
+#endif /* CERT_ADMIT_ENABLED */
+#if HOST_FRONTEND_PORT
+  /* A load generator on the host would flood the log. */
+  if(!host_frontend_is_peer(peer))
+#endif /* HOST_FRONTEND_PORT */
+  {
+    /* Only the collect-view header goes to the log, not the fragment. */
+    collect_common_recv(&sender, seqno, hops, appdata + 2,
+                        sizeof(struct collect_view_data_msg));
+  }
+  //PRINTF("Message from service-client: %s \n", appdata+2+sizeof(struct collect_view_data_msg) );
+  link_rx_bytes += len;
+  s = session_lookup(peer);
+  if((appdata[1] & CERT_FLIGHT_START) && s->flight_count != 0) {
+    /* The client timed out and started over, so does its session. */
+    session_release(s);
+    s = session_lookup(peer);
+  }
+  if(s->verify_pending) {
+    /* The reply goes out once the batch containing this client is done. */
+    return;
+  }
+  s->flight_count = s->flight_count + 1;
+#if CERT_CBOR_ENABLED
+  if(cert_peer_input(&s->peer_dec, &s->peer_cert,
+                     appdata + hdr_len + CERT_CRYPTO_HDR_LEN,
+                     plain_len) == CERT_CBOR_ERROR) {
+    printf("certificate of client rejected\n");
+    session_release(s);
+    return;
+  }
+#endif /* CERT_CBOR_ENABLED */
+  if(s->flight_count == MAX_CERT_FLIGHT) {
+    //wait for some secon and then go ahead
+    send_reply_to_peer(s);
+    session_release(s);
+#if CERT_CACHE_ENABLED
+    printf("root bytes [%lu] tx [%lu] rx [%lu] cache\n",
+           link_tx_bytes, link_rx_bytes, cert_cache_bytes());
+#else /* CERT_CACHE_ENABLED */
+    printf("root bytes [%lu] tx [%lu] rx [0] cache\n",
+           link_tx_bytes, link_rx_bytes);
+#endif /* CERT_CACHE_ENABLED */
+  } else {
+    if(s->flight_count == 1) { // first packet
+#if MERKLE_BATCH_ENABLED
+      /* Leaf = H(client id || first fragment), as the client computes it. */
+      mark = scratch_mark();
+      ctx = scratch_alloc(sizeof(*ctx));
+      if(ctx == NULL) {
+        return;
+      }
+      merkle_leaf_begin(ctx);
+      sha256_update(ctx, appdata + hdr_len, 2);
+      sha256_update(ctx, appdata + hdr_len + CERT_CRYPTO_HDR_LEN, plain_len);
+      sha256_final(ctx, s->leaf);
+      scratch_release(mark);
+      batch_join(s);
+#elif BATCH_VERIFY_ENABLED
+      if(batch_verify_submit(s, appdata + hdr_len + CERT_CRYPTO_HDR_LEN,
+                             plain_len)) {
+        s->verify_pending = 1;
+        return;
       }
-      send_reply_to_peer();
+      /* Queue full: check this one on the spot. */
+      singnature_varification();
+#else /* MERKLE_BATCH_ENABLED */
+      singnature_varification();
+#endif /* MERKLE_BATCH_ENABLED */
+      key_generation_exponential();
     }
+    send_reply_to_peer(s);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcpip_handler(void)
+{
+  if(uip_newdata()) {
+    handle_fragment(&UIP_IP_BUF->srcipaddr, (uint8_t *)uip_appdata,
+                    uip_datalen(),
+                    uip_ds6_if.cur_hop_limit - UIP_IP_BUF->ttl + 1);
   } else if(uip_rexmit()) { // packet drop need to retransmit
-    send_reply_to_peer();
+    send_reply_to_peer(NULL);
   }
 }
+#if CERT_REVOKE_ENABLED
+/*---------------------------------------------------------------------------*/
+/* Answers a status query against the exact revocation list, echoing
+   the query's seal counter so the client can match the answer. */
+static void
+revoke_input(void)
+{
+  scratch_mark_t mark;
+  uint8_t *buf;
+  uint8_t *plain;
+  uint8_t counter[4];
+  int len;
+
+  if(!uip_newdata()) {
+    return;
+  }
+  mark = scratch_mark();
+  buf = scratch_alloc(CERT_REVOKE_ANSWER_LEN + CERT_CRYPTO_OVERHEAD);
+  if(buf == NULL || uip_datalen() != SHA256_BLOCK_SIZE + CERT_CRYPTO_OVERHEAD) {
+    scratch_release(mark);
+    return;
+  }
+  memcpy(buf, uip_appdata, uip_datalen());
+  len = cert_crypto_open(buf, uip_datalen());
+  if(len != SHA256_BLOCK_SIZE) {
+    printf("revoke: dropping query, bad MIC\n");
+    scratch_release(mark);
+    return;
+  }
+  /* Sealing the answer overwrites the query's header. */
+  memcpy(counter, buf + 2, sizeof(counter));
+  plain = buf + CERT_CRYPTO_HDR_LEN;
+  plain[SHA256_BLOCK_SIZE] = cert_revoke_listed(plain) ?
+    CERT_REVOKE_REVOKED : CERT_REVOKE_CLEAR;
+  memcpy(plain + SHA256_BLOCK_SIZE + 1, counter, sizeof(counter));
+  printf("revoke: query from [%u]: %s\n",
+         UIP_IP_BUF->srcipaddr.u8[15] + (UIP_IP_BUF->srcipaddr.u8[14] << 8),
+         plain[SHA256_BLOCK_SIZE] == CERT_REVOKE_REVOKED ? "revoked" : "clear");
+  len = cert_crypto_seal(buf, CERT_REVOKE_ANSWER_LEN);
+  if(len != 0) {
+    uip_udp_packet_sendto(revoke_conn, buf, len, &UIP_IP_BUF->srcipaddr,
+                          UIP_HTONS(CERT_REVOKE_CLIENT_PORT));
+  }
+  scratch_release(mark);
+}
+#endif /* CERT_REVOKE_ENABLED */
+#if HOST_FRONTEND_PORT && !CERT_GATEWAY_WORKERS
+/*---------------------------------------------------------------------------*/
+static void
+host_input(const uip_ipaddr_t *peer, uint8_t *data, uint16_t len)
+{
+  handle_fragment(peer, data, len, 0);
+}
+#endif /* HOST_FRONTEND_PORT && !CERT_GATEWAY_WORKERS */
 /*---------------------------------------------------------------------------*/
 static void
 print_local_addresses(void)
@@ -303,23 +730,49 @@ PROCESS_THREAD(udp_server_process, ev, data)
   PRINTF("UDP server started\n");
 
 #if UIP_CONF_ROUTER
-  uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
-  /* uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr); */
-  uip_ds6_addr_add(&ipaddr, 0, ADDR_MANUAL);
-  root_if = uip_ds6_addr_lookup(&ipaddr);
-  if(root_if != NULL) {
-    rpl_dag_t *dag;
-    dag = rpl_set_root(RPL_DEFAULT_INSTANCE,(uip_ip6addr_t *)&ipaddr);
+#if PROVIDER_SELECT_ENABLED
+  if(!provider_select_is_root()) {
+    /* Join the root's DODAG as a router and register with it. */
     uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
-    rpl_set_prefix(dag, &ipaddr, 64);
-    PRINTF("created a new RPL dag\n");
-  } else {
-    PRINTF("failed to create a new RPL DAG\n");
+    uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
+    uip_ds6_addr_add(&ipaddr, 0, ADDR_AUTOCONF);
+    PRINTF("joining the root provider's RPL dag\n");
+  } else
+#endif /* PROVIDER_SELECT_ENABLED */
+  {
+    uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+    /* uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr); */
+    uip_ds6_addr_add(&ipaddr, 0, ADDR_MANUAL);
+    root_if = uip_ds6_addr_lookup(&ipaddr);
+    if(root_if != NULL) {
+      rpl_dag_t *dag;
+      dag = rpl_set_root(RPL_DEFAULT_INSTANCE,(uip_ip6addr_t *)&ipaddr);
+      uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+      rpl_set_prefix(dag, &ipaddr, 64);
+      PRINTF("created a new RPL dag\n");
+    } else {
+      PRINTF("failed to create a new RPL DAG\n");
+    }
   }
 #endif /* UIP_CONF_ROUTER */
 
   print_local_addresses();
 
+  cert_crypto_init();
+#if CERT_CACHE_ENABLED
+  cert_cache_init();
+#endif /* CERT_CACHE_ENABLED */
+#if CERT_TRICKLE_ENABLED
+  cert_trickle_init(1);
+#endif /* CERT_TRICKLE_ENABLED */
+#if BATCH_VERIFY_ENABLED
+  batch_verify_init(verify_done);
+#if BATCH_VERIFY_CONF_BENCH
+  sha256_mb_benchmark();
+  batch_verify_benchmark();
+#endif /* BATCH_VERIFY_CONF_BENCH */
+#endif /* BATCH_VERIFY_ENABLED */
+
   /* The data sink runs with a 100% duty cycle in order to ensure high
      packet reception rates. */
   NETSTACK_RDC.off(1);
@@ -330,15 +783,57 @@ PROCESS_THREAD(udp_server_process, ev, data)
   PRINTF("Created a server connection with remote address ");
   PRINT6ADDR(&server_conn->ripaddr);
   PRINTF(" local/remote port %u/%u\n", UIP_HTONS(server_conn->lport), UIP_HTONS(server_conn->rport));
+#if CERT_REVOKE_ENABLED
+  revoke_conn = udp_new(NULL, 0, NULL);
+  udp_bind(revoke_conn, UIP_HTONS(CERT_REVOKE_PROVIDER_PORT));
+#endif /* CERT_REVOKE_ENABLED */
+#if PROVIDER_SELECT_ENABLED
+  provider_select_provider_init();
+#endif /* PROVIDER_SELECT_ENABLED */
+#if CERT_ADMIT_ENABLED
+  cert_admit_provider_init();
+#endif /* CERT_ADMIT_ENABLED */
+#if CERT_GATEWAY_WORKERS
+  cert_gateway_init();
+#elif HOST_FRONTEND_PORT
+  host_frontend_init(host_input);
+#endif /* CERT_GATEWAY_WORKERS */
 
   while(1) {
     PROCESS_YIELD();
+    ram_mon_process(NULL);
     if(ev == tcpip_event) {
+#if CERT_REVOKE_ENABLED
+      if(uip_udp_conn == revoke_conn) {
+        revoke_input();
+      } else
+#endif /* CERT_REVOKE_ENABLED */
+#if PROVIDER_SELECT_ENABLED
+      if(uip_udp_conn == provider_select_conn()) {
+        provider_select_input();
+      } else
+#endif /* PROVIDER_SELECT_ENABLED */
+#if CERT_CACHE_ENABLED
+      if(uip_udp_conn == cert_cache_conn()) {
+        cert_cache_input();
+      } else
+#endif /* CERT_CACHE_ENABLED */
+#if CERT_TRICKLE_ENABLED
+      if(uip_udp_conn == cert_trickle_conn()) {
+        cert_trickle_input();
+      } else
+#endif /* CERT_TRICKLE_ENABLED */
+#if CERT_ADMIT_ENABLED
+      if(uip_udp_conn == cert_admit_conn()) {
+        /* Only clients are told to come back later. */
+      } else
+#endif /* CERT_ADMIT_ENABLED */
       tcpip_handler();
     } else if (ev == sensors_event && data == &button_sensor) {
       PRINTF("Initiaing global repair\n");
       rpl_repair_root(RPL_DEFAULT_INSTANCE);
     }
+    ram_mon_process(PROCESS_CURRENT());
   }
 
   PROCESS_END();
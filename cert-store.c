@@ -0,0 +1,276 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Certificate store on external flash.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#if !CONTIKI_TARGET_NATIVE
+#include "cfs/cfs-coffee.h"
+#endif /* !CONTIKI_TARGET_NATIVE */
+#include "cert-store.h"
+#include "scratch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if CERT_STORE_ENABLED
+
+#define INDEX_FILE "certidx"
+
+struct entry {
+  uint8_t id[CERT_STORE_ID_LEN];
+  uint16_t size;
+  uint8_t used;
+};
+
+static struct entry entries[CERT_STORE_ENTRIES];
+
+/* Last entry read stays open, fragments are read one after another. */
+static int read_fd = -1;
+static int read_slot = -1;
+
+static int write_fd = -1;
+static int write_slot;
+static uint16_t write_size;
+static uint16_t write_left;
+static uint8_t write_id[CERT_STORE_ID_LEN];
+
+/*---------------------------------------------------------------------------*/
+static void
+file_name(char *name, int slot)
+{
+  sprintf(name, "cert%d", slot);
+}
+/*---------------------------------------------------------------------------*/
+static void
+close_reader(void)
+{
+  if(read_fd >= 0) {
+    cfs_close(read_fd);
+    read_fd = -1;
+    read_slot = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+save_index(void)
+{
+  int fd;
+  int ok;
+
+  cfs_remove(INDEX_FILE);
+  fd = cfs_open(INDEX_FILE, CFS_WRITE);
+  if(fd < 0) {
+    return -1;
+  }
+  ok = cfs_write(fd, entries, sizeof(entries)) == sizeof(entries);
+  cfs_close(fd);
+  return ok ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_store_subject_id(const char *subject, uint8_t id[CERT_STORE_ID_LEN])
+{
+  SHA256_CTX ctx;
+  uint8_t digest[SHA256_BLOCK_SIZE];
+
+  sha256_init(&ctx);
+  sha256_update(&ctx, (const uint8_t *)subject, strlen(subject));
+  sha256_final(&ctx, digest);
+  memcpy(id, digest, CERT_STORE_ID_LEN);
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_store_init(void)
+{
+  int fd;
+  int i;
+
+  fd = cfs_open(INDEX_FILE, CFS_READ);
+  if(fd < 0 || cfs_read(fd, entries, sizeof(entries)) != sizeof(entries)) {
+    memset(entries, 0, sizeof(entries));
+  }
+  if(fd >= 0) {
+    cfs_close(fd);
+  }
+  for(i = 0; i < CERT_STORE_ENTRIES; i++) {
+    if(entries[i].used) {
+      printf("cert store: slot [%d] [%u] B\n", i, entries[i].size);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_store_find(const uint8_t id[CERT_STORE_ID_LEN])
+{
+  int i;
+
+  for(i = 0; i < CERT_STORE_ENTRIES; i++) {
+    if(entries[i].used && memcmp(entries[i].id, id, CERT_STORE_ID_LEN) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+cert_store_size(int slot)
+{
+  if(slot < 0 || slot >= CERT_STORE_ENTRIES || !entries[slot].used) {
+    return 0;
+  }
+  return entries[slot].size;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_store_read(int slot, uint16_t offset, uint8_t *buf, uint16_t len)
+{
+  char name[16];
+
+  if(cert_store_size(slot) == 0 || offset > entries[slot].size) {
+    return -1;
+  }
+  if(len > entries[slot].size - offset) {
+    len = entries[slot].size - offset;
+  }
+  if(read_slot != slot) {
+    close_reader();
+    file_name(name, slot);
+    read_fd = cfs_open(name, CFS_READ);
+    if(read_fd < 0) {
+      return -1;
+    }
+    read_slot = slot;
+  }
+  if(cfs_seek(read_fd, offset, CFS_SEEK_SET) != offset) {
+    close_reader();
+    return -1;
+  }
+  return cfs_read(read_fd, buf, len);
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_store_hash(int slot, SHA256_CTX *ctx)
+{
+  scratch_mark_t mark;
+  uint8_t *chunk;
+  uint16_t offset;
+  int n;
+
+  mark = scratch_mark();
+  chunk = scratch_alloc(CERT_STORE_CHUNK);
+  if(chunk == NULL) {
+    return -1;
+  }
+  for(offset = 0; offset < cert_store_size(slot); offset += n) {
+    n = cert_store_read(slot, offset, chunk, CERT_STORE_CHUNK);
+    if(n <= 0) {
+      scratch_release(mark);
+      return -1;
+    }
+    sha256_update(ctx, chunk, n);
+  }
+  scratch_release(mark);
+  return offset > 0 ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_store_put_begin(const uint8_t id[CERT_STORE_ID_LEN], uint16_t size)
+{
+  char name[16];
+  int slot;
+
+  if(write_fd >= 0) {
+    return -1;
+  }
+  slot = cert_store_find(id);
+  if(slot >= 0) {
+    /* Out of the index first, so a torn rewrite is never read back. */
+    entries[slot].used = 0;
+    save_index();
+  } else {
+    for(slot = 0; slot < CERT_STORE_ENTRIES && entries[slot].used; slot++);
+    if(slot == CERT_STORE_ENTRIES) {
+      return -1;
+    }
+  }
+  if(read_slot == slot) {
+    close_reader();
+  }
+
+  file_name(name, slot);
+  cfs_remove(name);
+#if !CONTIKI_TARGET_NATIVE
+  /* Coffee extends files by copying them; reserve the final size. */
+  if(cfs_coffee_reserve(name, size) < 0) {
+    return -1;
+  }
+#endif /* !CONTIKI_TARGET_NATIVE */
+  write_fd = cfs_open(name, CFS_WRITE);
+  if(write_fd < 0) {
+    return -1;
+  }
+  write_slot = slot;
+  write_size = size;
+  write_left = size;
+  memcpy(write_id, id, CERT_STORE_ID_LEN);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_store_put(const uint8_t *data, uint16_t len)
+{
+  if(write_fd < 0 || len > write_left ||
+     cfs_write(write_fd, data, len) != len) {
+    return -1;
+  }
+  write_left -= len;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+cert_store_put_end(void)
+{
+  if(write_fd < 0) {
+    return -1;
+  }
+  cfs_close(write_fd);
+  write_fd = -1;
+  if(write_left != 0) {
+    return -1;
+  }
+  memcpy(entries[write_slot].id, write_id, CERT_STORE_ID_LEN);
+  entries[write_slot].size = write_size;
+  entries[write_slot].used = 1;
+  return save_index();
+}
+/*---------------------------------------------------------------------------*/
+#endif /* CERT_STORE_ENABLED */
@@ -0,0 +1,109 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Certificate store on external flash (Coffee on the sky, plain
+ *         files on native). Entries are indexed by a truncated SHA-256
+ *         of their subject; the index is a small file loaded into RAM at
+ *         boot. Certificates are never held in RAM as a whole: they are
+ *         written and read back in chunks, straight into sha256_update()
+ *         or a fragment buffer.
+ *
+ *         On first boot cert_store_init() provisions the two entries the
+ *         handshake uses with the stand-in contents it used to build in
+ *         RAM, so digests and fragments are unchanged:
+ *
+ *         CERT_STORE_ANCHOR: the certificate body hashed by
+ *                            hash_generation() (after the constant
+ *                            prefix, see cert-crypto.c).
+ *         CERT_STORE_CHAIN:  the chain sent in the flight, one
+ *                            CERT_STORE_FRAGMENT_LEN slice per fragment.
+ */
+
+#ifndef CERT_STORE_H_
+#define CERT_STORE_H_
+
+#include "contiki.h"
+#include "sha256.h"
+
+#ifdef CERT_STORE_CONF_ENABLED
+#define CERT_STORE_ENABLED CERT_STORE_CONF_ENABLED
+#else
+#define CERT_STORE_ENABLED 0
+#endif
+
+/* Entries in the index; each is one file. */
+#ifdef CERT_STORE_CONF_ENTRIES
+#define CERT_STORE_ENTRIES CERT_STORE_CONF_ENTRIES
+#else
+#define CERT_STORE_ENTRIES 8
+#endif
+
+/* Bytes moved per flash access when streaming into the hash. */
+#ifdef CERT_STORE_CONF_CHUNK
+#define CERT_STORE_CHUNK CERT_STORE_CONF_CHUNK
+#else
+#define CERT_STORE_CHUNK 64
+#endif
+
+#define CERT_STORE_ID_LEN 8
+
+/* Flight geometry of the stand-in chain. */
+#define CERT_STORE_FRAGMENT_LEN 128
+#define CERT_STORE_FRAGMENTS    18
+
+/* Subjects of the provisioned entries. */
+#define CERT_STORE_ANCHOR "Contiki PUF CA"
+#define CERT_STORE_CHAIN  "chain"
+
+/* id = first CERT_STORE_ID_LEN bytes of SHA-256(subject). */
+void cert_store_subject_id(const char *subject, uint8_t id[CERT_STORE_ID_LEN]);
+
+void cert_store_init(void);
+
+/* Index slot of the entry with this id, or -1. */
+int cert_store_find(const uint8_t id[CERT_STORE_ID_LEN]);
+uint16_t cert_store_size(int slot);
+
+/* Copies up to len bytes from offset; returns the number copied or -1. */
+int cert_store_read(int slot, uint16_t offset, uint8_t *buf, uint16_t len);
+
+/* Feeds the whole entry to sha256_update(). Returns 0, or -1 on a read
+   error. */
+int cert_store_hash(int slot, SHA256_CTX *ctx);
+
+/*
+ * Streaming write: begin with the total size, append the contents in
+ * any number of pieces, then end. The entry replaces any previous one
+ * with the same id and only enters the index once complete.
+ */
+int cert_store_put_begin(const uint8_t id[CERT_STORE_ID_LEN], uint16_t size);
+int cert_store_put(const uint8_t *data, uint16_t len);
+int cert_store_put_end(void);
+
+#endif /* CERT_STORE_H_ */
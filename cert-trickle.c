@@ -0,0 +1,427 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Trickle dissemination of the provider certificate.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "lib/trickle-timer.h"
+#include "net/ip/uip.h"
+#include "net/ip/uip-udp-packet.h"
+#include "cert-trickle.h"
+#include "cert-crypto.h"
+#include "cert-cache.h"
+#include "scratch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if CERT_TRICKLE_ENABLED
+
+#define MSG_SUMMARY  'V'
+#define MSG_REQUEST  'R'
+#define MSG_FRAGMENT 'D'
+#define SUMMARY_LEN      8
+#define REQUEST_LEN      7
+#define FRAGMENT_HDR_LEN 5
+
+/* Fragment size, as in the flight. */
+#define FRAGMENT_LEN 128
+/* Fragments of the stand-in chain, as in the flight. */
+#define CHAIN_FRAGMENTS 18
+/* Masks are 32 bits. */
+#define MAX_FRAGMENTS 32
+
+/* Spread of the pause before a queued fragment or request goes out, so
+   that neighbours get to overhear each other and drop duplicates. */
+#define SEND_JITTER (CLOCK_SECOND / 4)
+
+static struct uip_udp_conn *conn;
+static uip_ipaddr_t all_nodes;
+static struct trickle_timer tt;
+static struct ctimer send_timer;
+
+static uint8_t is_source;
+static uint16_t version;
+/* Fragments of this version, 0 if it does not fit CERT_TRICKLE_SIZE. */
+static uint8_t count;
+static uint32_t have;
+/* Fragments neighbours are missing, and whether we miss some. */
+static uint32_t to_send;
+static uint8_t want_request;
+static uint8_t cert[CERT_TRICKLE_SIZE];
+static uint16_t cert_len;
+static clock_time_t heard;
+
+static unsigned long sent_summaries, sent_requests, sent_fragments;
+
+/*---------------------------------------------------------------------------*/
+static uint32_t
+full(void)
+{
+  return count == MAX_FRAGMENTS ? 0xffffffffUL : (1UL << count) - 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+own_count(void)
+{
+#if CERT_CBOR_ENABLED
+  return cert_fragment_count(FRAGMENT_LEN);
+#else /* CERT_CBOR_ENABLED */
+  return CHAIN_FRAGMENTS;
+#endif /* CERT_CBOR_ENABLED */
+}
+/*---------------------------------------------------------------------------*/
+static void
+put32(uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+}
+/*---------------------------------------------------------------------------*/
+/* buf holds the message at CERT_CRYPTO_HDR_LEN, with its version set here. */
+static void
+broadcast(uint8_t *buf, uint16_t len)
+{
+  buf[CERT_CRYPTO_HDR_LEN + 1] = version >> 8;
+  buf[CERT_CRYPTO_HDR_LEN + 2] = version & 0xff;
+  len = cert_crypto_seal(buf, len);
+  if(len != 0) {
+    uip_udp_packet_sendto(conn, buf, len, &all_nodes,
+                          UIP_HTONS(CERT_TRICKLE_PORT));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_fragment(uint8_t index)
+{
+  scratch_mark_t mark;
+  uint16_t offset;
+  uint16_t len;
+  uint8_t *buf;
+  uint8_t *p;
+
+  mark = scratch_mark();
+  buf = scratch_alloc(FRAGMENT_HDR_LEN + FRAGMENT_LEN + CERT_CRYPTO_OVERHEAD);
+  if(buf != NULL) {
+    p = buf + CERT_CRYPTO_HDR_LEN;
+    p[0] = MSG_FRAGMENT;
+    p[3] = index;
+    p[4] = count;
+    if(is_source) {
+      len = cert_fragment_load(index, p + FRAGMENT_HDR_LEN, FRAGMENT_LEN);
+    } else {
+      offset = index * FRAGMENT_LEN;
+      len = cert_len - offset < FRAGMENT_LEN ? cert_len - offset : FRAGMENT_LEN;
+      memcpy(p + FRAGMENT_HDR_LEN, cert + offset, len);
+    }
+    broadcast(buf, FRAGMENT_HDR_LEN + len);
+    sent_fragments++;
+  }
+  scratch_release(mark);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_next(void *ptr)
+{
+  uint8_t buf[REQUEST_LEN + CERT_CRYPTO_OVERHEAD];
+  uint8_t i;
+
+  if(want_request) {
+    want_request = 0;
+    if((full() & ~have) != 0) {
+      buf[CERT_CRYPTO_HDR_LEN] = MSG_REQUEST;
+      put32(buf + CERT_CRYPTO_HDR_LEN + 3, full() & ~have);
+      broadcast(buf, REQUEST_LEN);
+      sent_requests++;
+    }
+  } else if(to_send != 0) {
+    for(i = 0; (to_send & (1UL << i)) == 0; i++);
+    to_send &= ~(1UL << i);
+    send_fragment(i);
+  }
+  if(want_request || to_send != 0) {
+    ctimer_set(&send_timer, 1 + random_rand() % SEND_JITTER, send_next, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule(void)
+{
+  if(ctimer_expired(&send_timer)) {
+    ctimer_set(&send_timer, 1 + random_rand() % SEND_JITTER, send_next, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+trickle_tx(void *ptr, uint8_t suppress)
+{
+  uint8_t buf[SUMMARY_LEN + CERT_CRYPTO_OVERHEAD];
+
+  if(suppress == TRICKLE_TIMER_TX_SUPPRESS) {
+    return;
+  }
+  buf[CERT_CRYPTO_HDR_LEN] = MSG_SUMMARY;
+  buf[CERT_CRYPTO_HDR_LEN + 3] = count;
+  put32(buf + CERT_CRYPTO_HDR_LEN + 4, have);
+  broadcast(buf, SUMMARY_LEN);
+  sent_summaries++;
+}
+/*---------------------------------------------------------------------------*/
+/* Source: offers its own certificate as version v. */
+static void
+publish(uint16_t v)
+{
+  version = v;
+  count = own_count();
+  have = full();
+  to_send = 0;
+  heard = clock_time();
+  trickle_timer_inconsistency(&tt);
+}
+/*---------------------------------------------------------------------------*/
+static void
+adopt(uint16_t v, uint8_t c)
+{
+  version = v;
+  count = c;
+  if(c > MAX_FRAGMENTS || c == 0 || (c - 1) * FRAGMENT_LEN >= CERT_TRICKLE_SIZE) {
+    printf("trickle: version [%u] of [%u] fragments does not fit\n", v, c);
+    count = 0;
+  }
+  have = 0;
+  to_send = 0;
+  cert_len = 0;
+  heard = clock_time();
+  want_request = 1;
+  schedule();
+  trickle_timer_inconsistency(&tt);
+}
+/*---------------------------------------------------------------------------*/
+/* A newer version was heard. The source never takes one from its
+   neighbours: after a reboot it restarts at 1 while they still hold the
+   old number, so it moves past theirs instead. */
+static void
+newer(uint16_t v, uint8_t c)
+{
+  if(is_source) {
+    printf("trickle: neighbours at version [%u], republishing as [%u]\n",
+           v, v + 1);
+    publish(v + 1);
+  } else {
+    adopt(v, c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+complete(void)
+{
+#if CERT_CBOR_ENABLED
+  struct cert_cbor_decoder d;
+  struct cert_cbor c;
+
+  memset(&d, 0, sizeof(d));
+  if(cert_peer_input(&d, &c, cert, cert_len) != CERT_CBOR_DONE) {
+    printf("trickle: version [%u] rejected\n", version);
+    return;
+  }
+#endif /* CERT_CBOR_ENABLED */
+#if CERT_CACHE_ENABLED
+  /* Flights that name this certificate are now served locally. */
+  cert_cache_insert(cert, cert_len);
+#endif /* CERT_CACHE_ENABLED */
+  printf("trickle: version [%u] complete in [%lu] ms, sent [%lu] summaries [%lu] requests [%lu] fragments\n",
+         version, (unsigned long)(clock_time() - heard) * 1000 / CLOCK_SECOND,
+         sent_summaries, sent_requests, sent_fragments);
+  trickle_timer_inconsistency(&tt);
+}
+/*---------------------------------------------------------------------------*/
+static void
+summary_input(uint16_t v, uint8_t c, uint32_t h)
+{
+  if(v > version) {
+    newer(v, c);
+    return;
+  }
+  if(v < version) {
+    trickle_timer_inconsistency(&tt);
+    return;
+  }
+  if(h == have) {
+    trickle_timer_consistency(&tt);
+    return;
+  }
+  if((h & ~have) != 0) {
+    want_request = 1;
+    schedule();
+  }
+  if((have & ~h) != 0) {
+    to_send |= have & ~h;
+    schedule();
+  }
+  trickle_timer_inconsistency(&tt);
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_input(uint16_t v, uint32_t missing)
+{
+  if(v != version) {
+    return;
+  }
+  if((have & missing) != 0) {
+    to_send |= have & missing;
+    schedule();
+  }
+  /* A neighbour asked for everything we miss. */
+  if((full() & ~have & ~missing) == 0) {
+    want_request = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+fragment_input(uint16_t v, uint8_t index, uint8_t c,
+               const uint8_t *data, uint16_t len)
+{
+  uint16_t offset;
+
+  if(v > version) {
+    newer(v, c);
+  }
+  if(v != version || index >= count || c != count) {
+    return;
+  }
+  /* Sent by a neighbour, ours would be a duplicate. */
+  to_send &= ~(1UL << index);
+  offset = index * FRAGMENT_LEN;
+  if((have & (1UL << index)) != 0 || is_source ||
+     len > FRAGMENT_LEN || offset + len > CERT_TRICKLE_SIZE) {
+    return;
+  }
+  memcpy(cert + offset, data, len);
+  have |= 1UL << index;
+  if(offset + len > cert_len) {
+    cert_len = offset + len;
+  }
+  if(have == full()) {
+    complete();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_trickle_init(int source)
+{
+  uip_create_linklocal_allnodes_mcast(&all_nodes);
+  conn = udp_new(NULL, UIP_HTONS(CERT_TRICKLE_PORT), NULL);
+  udp_bind(conn, UIP_HTONS(CERT_TRICKLE_PORT));
+
+  is_source = source;
+  trickle_timer_config(&tt, CERT_TRICKLE_IMIN, CERT_TRICKLE_IMAX, CERT_TRICKLE_K);
+  trickle_timer_set(&tt, trickle_tx, NULL);
+  if(is_source) {
+    publish(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct uip_udp_conn *
+cert_trickle_conn(void)
+{
+  return conn;
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_trickle_input(void)
+{
+  uint8_t *p;
+  uint16_t v;
+  int len;
+
+  if(!uip_newdata()) {
+    return;
+  }
+  len = cert_crypto_open(uip_appdata, uip_datalen());
+  if(len < 3) {
+    return;
+  }
+  p = (uint8_t *)uip_appdata + CERT_CRYPTO_HDR_LEN;
+  v = (p[1] << 8) | p[2];
+  if(p[0] == MSG_SUMMARY && len == SUMMARY_LEN) {
+    summary_input(v, p[3], get32(p + 4));
+  } else if(p[0] == MSG_REQUEST && len == REQUEST_LEN) {
+    request_input(v, get32(p + 3));
+  } else if(p[0] == MSG_FRAGMENT && len > FRAGMENT_HDR_LEN) {
+    fragment_input(v, p[3], p[4], p + FRAGMENT_HDR_LEN, len - FRAGMENT_HDR_LEN);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_trickle_rotate(void)
+{
+  if(!is_source) {
+    printf("trickle: only the provider rotates\n");
+    return;
+  }
+#if CERT_CBOR_ENABLED
+  cert_crypto_rotate();
+#endif /* CERT_CBOR_ENABLED */
+#if CERT_CACHE_ENABLED
+  cert_cache_own_changed();
+#endif /* CERT_CACHE_ENABLED */
+  sent_summaries = 0;
+  sent_requests = 0;
+  sent_fragments = 0;
+  publish(version + 1);
+  printf("trickle: rotated to version [%u]\n", version);
+}
+/*---------------------------------------------------------------------------*/
+void
+cert_trickle_stats(void)
+{
+  uint8_t held;
+  uint32_t m;
+
+  held = 0;
+  for(m = have; m != 0; m &= m - 1) {
+    held++;
+  }
+  printf("trickle: version [%u] fragments [%u/%u] interval [%lu] ms sent [%lu] summaries [%lu] requests [%lu] fragments\n",
+         version, held, count,
+         (unsigned long)tt.i_cur * 1000 / CLOCK_SECOND,
+         sent_summaries, sent_requests, sent_fragments);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* CERT_TRICKLE_ENABLED */
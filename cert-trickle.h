@@ -0,0 +1,107 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Trickle dissemination of the provider certificate. Instead of
+ *         every client pulling it in its own flight, the provider's
+ *         certificate spreads hop by hop with link-local broadcasts:
+ *
+ *           SUMMARY  ['V'][version (2)][count (1)][have mask (4)]
+ *           REQUEST  ['R'][version (2)][missing mask (4)]
+ *           FRAGMENT ['D'][version (2)][index (1)][count (1)][data]
+ *
+ *         Summaries go out under a Trickle timer (RFC 6206), so in a
+ *         steady neighbourhood only about k per interval are sent,
+ *         however many nodes there are. A node that hears a newer
+ *         version asks for the fragments it is missing, a node that has
+ *         them broadcasts them once, and a fragment or request overheard
+ *         from a neighbour cancels the same one queued locally. Hearing
+ *         anything that differs from its own state resets a node's
+ *         Trickle interval.
+ *
+ *         The provider is the source and bumps the version when its
+ *         certificate is rotated. Nodes print the time from first
+ *         hearing a version to holding all of it, and what they sent.
+ */
+
+#ifndef CERT_TRICKLE_H_
+#define CERT_TRICKLE_H_
+
+#include "contiki.h"
+
+#ifdef CERT_TRICKLE_CONF_ENABLED
+#define CERT_TRICKLE_ENABLED CERT_TRICKLE_CONF_ENABLED
+#else
+#define CERT_TRICKLE_ENABLED 0
+#endif
+
+/* Smallest interval, and how many times it may double. */
+#ifdef CERT_TRICKLE_CONF_IMIN
+#define CERT_TRICKLE_IMIN CERT_TRICKLE_CONF_IMIN
+#else
+#define CERT_TRICKLE_IMIN (CLOCK_SECOND * 2)
+#endif
+
+#ifdef CERT_TRICKLE_CONF_IMAX
+#define CERT_TRICKLE_IMAX CERT_TRICKLE_CONF_IMAX
+#else
+#define CERT_TRICKLE_IMAX 8
+#endif
+
+/* Redundancy constant: consistent summaries that suppress our own. */
+#ifdef CERT_TRICKLE_CONF_K
+#define CERT_TRICKLE_K CERT_TRICKLE_CONF_K
+#else
+#define CERT_TRICKLE_K 1
+#endif
+
+/* Certificate bytes a node holds; the default fits the CBOR profile. */
+#ifdef CERT_TRICKLE_CONF_SIZE
+#define CERT_TRICKLE_SIZE CERT_TRICKLE_CONF_SIZE
+#elif CONTIKI_TARGET_NATIVE
+#define CERT_TRICKLE_SIZE 2304
+#else
+#define CERT_TRICKLE_SIZE 256
+#endif
+
+#define CERT_TRICKLE_PORT 5692
+
+/* source is 1 on the provider. */
+void cert_trickle_init(int source);
+
+/* tcpip_event on the connection below. */
+void cert_trickle_input(void);
+struct uip_udp_conn *cert_trickle_conn(void);
+
+/* Source only: new certificate, new version. */
+void cert_trickle_rotate(void);
+
+/* Version, completeness and transmissions on one line. */
+void cert_trickle_stats(void);
+
+#endif /* CERT_TRICKLE_H_ */
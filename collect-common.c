@@ -43,6 +43,7 @@
 #include "collect-common.h"
 
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <ctype.h>
 
@@ -50,6 +51,16 @@
 #include "net/rime/rime.h"
 #include "net/rime/timesynch.h"
 #include "collect-view.h"
+#include "auth-prof.h"
+#include "collect-log.h"
+#include "latency-hist.h"
+#include "ram-mon.h"
+#include "cert-revoke.h"
+#include "replay-window.h"
+#include "provider-select.h"
+#include "cert-cache.h"
+#include "cert-trickle.h"
+#include "cert-admit.h"
 
 #include <string.h>
 
@@ -82,6 +93,53 @@ strtolong(const char *data) {
   }
   return value;
 }
+#if CERT_REVOKE_ENABLED
+/*---------------------------------------------------------------------------*/
+static int
+hexdigit(char c)
+{
+  return isdigit((unsigned char)c) ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+/*---------------------------------------------------------------------------*/
+/* Hex digits up to the end of the line; the byte count, or -1. */
+static int
+hextobytes(const char *data, uint8_t *buf, int max)
+{
+  int n;
+
+  for(n = 0; isxdigit((unsigned char)data[0]); n++, data += 2) {
+    if(n == max || !isxdigit((unsigned char)data[1])) {
+      return -1;
+    }
+    buf[n] = (hexdigit(data[0]) << 4) | hexdigit(data[1]);
+  }
+  return *data == '\0' ? n : -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+revoke_command(const char *line)
+{
+  uint8_t buf[64];
+  int len;
+
+  if(*line == '\0') {
+    cert_revoke_stats();
+  } else if(strncmp(line, " add ", 5) == 0) {
+    /* Provider: a digest for the exact list. */
+    if(hextobytes(line + 5, buf, sizeof(buf)) != SHA256_BLOCK_SIZE ||
+       cert_revoke_add(buf) < 0) {
+      printf("revoke: add failed\n");
+    } else {
+      printf("revoke: added\n");
+    }
+  } else if((len = hextobytes(line + 1, buf, sizeof(buf))) < 0 ||
+            cert_revoke_apply(buf, len) < 0) {
+    printf("revoke: delta rejected at version [%u]\n", cert_revoke_version());
+  } else {
+    printf("revoke: version [%u]\n", cert_revoke_version());
+  }
+}
+#endif /* CERT_REVOKE_ENABLED */
 /*---------------------------------------------------------------------------*/
 void
 collect_common_set_send_active(int active)
@@ -93,18 +151,11 @@ void
 collect_common_print_packet_detail (const linkaddr_t *originator, uint8_t seqno, uint8_t hops, uint8_t *payload, uint16_t payload_len) 
 {
 
-  unsigned long latency;
   unsigned long cpu, lpm, transmit, listen, clock, timesynch_time;
   struct collect_view_data_msg *msg = (struct collect_view_data_msg*) (payload)  ;
   
- 
- /*
- * need to enable this MACRO to get the synch time. 
- * Can be enabled here: /home/user/contiki/platform/sky/contiki-conf.h
- */
-#if TIMESYNCH_CONF_ENABLED 
-  latency = timesynch_time() - msg->timesynch_time ;
-#endif /* TIMESYNCH_CONF_ENABLED */
+
+  /* One-way latency goes to the histograms in latency-hist.c. */
 
   cpu = msg->cpu;
   lpm = msg->lpm;
@@ -120,10 +171,27 @@ void
 collect_common_recv(const linkaddr_t *originator, uint8_t seqno, uint8_t hops,
                     uint8_t *payload, uint16_t payload_len)
 {
+  rtimer_clock_t start;
+#if !COLLECT_LOG_BINARY
   unsigned long time;
   uint16_t data;
   int i;
+#endif /* !COLLECT_LOG_BINARY */
 
+  start = RTIMER_NOW();
+#if LATENCY_HIST_ENABLED
+  if(payload_len >= sizeof(struct collect_view_data_msg)) {
+    uint16_t sent_time;
+    memcpy(&sent_time,
+           payload + offsetof(struct collect_view_data_msg, timesynch_time),
+           sizeof(sent_time));
+    latency_hist_add(originator, hops, sent_time);
+  }
+#endif /* LATENCY_HIST_ENABLED */
+#if COLLECT_LOG_BINARY
+  /* Formatting is left to the host, see tools/collect-log-decode.py. */
+  collect_log_packet(get_time(), originator, seqno, hops, payload, payload_len);
+#else /* COLLECT_LOG_BINARY */
   collect_common_print_packet_detail(originator,seqno,hops,payload, payload_len);
 
   printf("%u", 8 + payload_len / 2);
@@ -138,6 +206,8 @@ collect_common_recv(const linkaddr_t *originator, uint8_t seqno, uint8_t hops,
     printf(" %u", data);
   }
   printf("\n");
+#endif /* COLLECT_LOG_BINARY */
+  collect_log_account(RTIMER_NOW() - start);
   leds_blink();
 }
 /*---------------------------------------------------------------------------*/
@@ -146,12 +216,16 @@ PROCESS_THREAD(collect_common_process, ev, data)
  
   PROCESS_BEGIN();
 
+  /* First, so every later frame is measured against this one. */
+  ram_mon_init();
   collect_common_net_init();
+  collect_log_init();
 
   /* Send a packet every 60-62 seconds. */
   etimer_set(&period_timer, CLOCK_SECOND * PERIOD);
   while(1) {
     PROCESS_WAIT_EVENT();
+    ram_mon_process(NULL);
     if(ev == serial_line_event_message) {
       char *line;
       line = (char *)data;
@@ -183,6 +257,60 @@ PROCESS_THREAD(collect_common_process, ev, data)
           printf("mac: turned MAC on: %s\n", NETSTACK_RDC.name);
         }
 
+      } else if(strncmp(line, "log", 3) == 0) {
+        collect_log_stats();
+      } else if(strncmp(line, "lat", 3) == 0) {
+        if(strncmp(line + 3, " reset", 6) == 0) {
+          latency_hist_reset();
+          printf("lat: reset\n");
+        } else {
+          latency_hist_dump();
+        }
+      } else if(strncmp(line, "ram", 3) == 0) {
+        if(strncmp(line + 3, " reset", 6) == 0) {
+          ram_mon_reset();
+          printf("ram: reset\n");
+        } else {
+          ram_mon_dump();
+        }
+      } else if(strncmp(line, "replay", 6) == 0) {
+        if(strncmp(line + 6, " reset", 6) == 0) {
+          replay_window_stats_reset();
+          printf("replay: reset\n");
+        } else {
+          replay_window_stats();
+        }
+      } else if(strncmp(line, "prof", 4) == 0) {
+        if(strncmp(line + 4, " reset", 6) == 0) {
+          auth_prof_reset();
+          printf("prof: reset\n");
+        } else {
+          auth_prof_dump();
+        }
+#if CERT_REVOKE_ENABLED
+      } else if(strncmp(line, "revoke", 6) == 0) {
+        revoke_command(line + 6);
+#endif /* CERT_REVOKE_ENABLED */
+#if PROVIDER_SELECT_ENABLED
+      } else if(strncmp(line, "providers", 9) == 0) {
+        provider_select_stats();
+#endif /* PROVIDER_SELECT_ENABLED */
+#if CERT_CACHE_ENABLED
+      } else if(strncmp(line, "cache", 5) == 0) {
+        cert_cache_stats();
+#endif /* CERT_CACHE_ENABLED */
+#if CERT_TRICKLE_ENABLED
+      } else if(strncmp(line, "trickle", 7) == 0) {
+        if(strncmp(line + 7, " rotate", 7) == 0) {
+          cert_trickle_rotate();
+        } else {
+          cert_trickle_stats();
+        }
+#endif /* CERT_TRICKLE_ENABLED */
+#if CERT_ADMIT_ENABLED
+      } else if(strncmp(line, "admit", 5) == 0) {
+        cert_admit_stats();
+#endif /* CERT_ADMIT_ENABLED */
       } else if(strncmp(line, "~K", 2) == 0 ||
                 strncmp(line, "killall", 7) == 0) {
         /* Ignore stop commands */
@@ -201,6 +329,7 @@ PROCESS_THREAD(collect_common_process, ev, data)
         }
       }
     }
+    ram_mon_process(PROCESS_CURRENT());
   }
 
   PROCESS_END();
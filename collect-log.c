@@ -0,0 +1,166 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Binary packet log for the collect sink.
+ */
+
+#include "contiki.h"
+#include "collect-log.h"
+#include "ram-mon.h"
+
+#include <stdio.h>
+
+#if COLLECT_LOG_BINARY
+static uint8_t ring[COLLECT_LOG_SIZE];
+static uint16_t head, tail;
+static uint16_t dropped;
+RAM_POOL(ring_pool, "log ring", COLLECT_LOG_SIZE, 1);
+
+PROCESS(collect_log_process, "collect log drain");
+#endif /* COLLECT_LOG_BINARY */
+
+static uint16_t logged;
+static unsigned long log_ticks;
+
+/*---------------------------------------------------------------------------*/
+void
+collect_log_account(rtimer_clock_t ticks)
+{
+  logged++;
+  log_ticks += ticks;
+}
+/*---------------------------------------------------------------------------*/
+void
+collect_log_stats(void)
+{
+  printf("log: %s, [%u] packets, avg [%lu] rtimer ticks/packet",
+         COLLECT_LOG_BINARY ? "binary" : "text", logged,
+         logged > 0 ? log_ticks / logged : 0);
+#if COLLECT_LOG_BINARY
+  printf(", [%u] records dropped", dropped);
+#endif /* COLLECT_LOG_BINARY */
+  printf("\n");
+}
+#if COLLECT_LOG_BINARY
+/*---------------------------------------------------------------------------*/
+static uint16_t
+ring_free(void)
+{
+  return (tail + COLLECT_LOG_SIZE - head - 1) % COLLECT_LOG_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+ring_put(uint8_t b, uint8_t *sum)
+{
+  ring[head] = b;
+  head = (head + 1) % COLLECT_LOG_SIZE;
+  *sum ^= b;
+}
+/*---------------------------------------------------------------------------*/
+void
+collect_log_packet(unsigned long time, const linkaddr_t *originator,
+                   uint8_t seqno, uint8_t hops,
+                   const uint8_t *payload, uint16_t payload_len)
+{
+  uint16_t body_len;
+  uint16_t addr;
+  uint8_t sum;
+  uint16_t i;
+
+  body_len = 8 + payload_len;
+  if(body_len > 255 || ring_free() < body_len + 4) {
+    /* Whole records only; they also go out whole, see the drain. */
+    dropped++;
+    return;
+  }
+
+  addr = originator->u8[0] + (originator->u8[1] << 8);
+  sum = 0;
+  ring[head] = COLLECT_LOG_SYNC;
+  head = (head + 1) % COLLECT_LOG_SIZE;
+  ring_put(COLLECT_LOG_TYPE_PACKET, &sum);
+  ring_put((uint8_t)body_len, &sum);
+  ring_put((uint8_t)time, &sum);
+  ring_put((uint8_t)(time >> 8), &sum);
+  ring_put((uint8_t)(time >> 16), &sum);
+  ring_put((uint8_t)(time >> 24), &sum);
+  ring_put((uint8_t)addr, &sum);
+  ring_put((uint8_t)(addr >> 8), &sum);
+  ring_put(seqno, &sum);
+  ring_put(hops, &sum);
+  for(i = 0; i < payload_len; i++) {
+    ring_put(payload[i], &sum);
+  }
+  ring[head] = sum;
+  head = (head + 1) % COLLECT_LOG_SIZE;
+  ram_pool_set(&ring_pool, COLLECT_LOG_SIZE - 1 - ring_free());
+
+  process_poll(&collect_log_process);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * One whole record per poll: printf output from other processes can only
+ * land between records, where the decoder passes it through as text,
+ * never inside one.
+ */
+PROCESS_THREAD(collect_log_process, ev, data)
+{
+  uint16_t n;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    if(tail != head) {
+      /* [sync][type][body length][body][checksum] */
+      n = ring[(tail + 2) % COLLECT_LOG_SIZE] + 4;
+      while(n-- > 0) {
+        putchar(ring[tail]);
+        tail = (tail + 1) % COLLECT_LOG_SIZE;
+      }
+      ram_pool_set(&ring_pool, COLLECT_LOG_SIZE - 1 - ring_free());
+    }
+    if(tail != head) {
+      /* Come back after whatever else is pending. */
+      process_poll(&collect_log_process);
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* COLLECT_LOG_BINARY */
+/*---------------------------------------------------------------------------*/
+void
+collect_log_init(void)
+{
+#if COLLECT_LOG_BINARY
+  process_start(&collect_log_process, NULL);
+#endif /* COLLECT_LOG_BINARY */
+}
+/*---------------------------------------------------------------------------*/
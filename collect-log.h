@@ -0,0 +1,73 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Binary packet log for the collect sink. Instead of formatting
+ *         every received packet with printf, collect_common_recv() stores
+ *         a compact record in a RAM ring buffer that is drained to the
+ *         serial port when the node has nothing else to do.
+ *         tools/collect-log-decode.py turns the records back into the
+ *         text lines collect-view expects.
+ *
+ *         Record: [0xa5][type][len][body (len bytes)][xor of type..body]
+ */
+
+#ifndef COLLECT_LOG_H_
+#define COLLECT_LOG_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+
+#ifdef COLLECT_LOG_CONF_BINARY
+#define COLLECT_LOG_BINARY COLLECT_LOG_CONF_BINARY
+#else
+#define COLLECT_LOG_BINARY 0
+#endif
+
+#ifdef COLLECT_LOG_CONF_SIZE
+#define COLLECT_LOG_SIZE COLLECT_LOG_CONF_SIZE
+#else
+#define COLLECT_LOG_SIZE 512
+#endif
+
+#define COLLECT_LOG_SYNC        0xa5
+#define COLLECT_LOG_TYPE_PACKET 0x01
+
+void collect_log_init(void);
+
+/* Body: time (u32 LE), originator (u16 LE), seqno, hops, payload. */
+void collect_log_packet(unsigned long time, const linkaddr_t *originator,
+                        uint8_t seqno, uint8_t hops,
+                        const uint8_t *payload, uint16_t payload_len);
+
+/* Accounts rtimer ticks spent logging one packet, in either mode. */
+void collect_log_account(rtimer_clock_t ticks);
+
+void collect_log_stats(void);
+
+#endif /* COLLECT_LOG_H_ */
@@ -0,0 +1,160 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Host UDP socket in front of a native provider.
+ */
+
+#include "contiki.h"
+#include "host-frontend.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+static int sock = -1;
+static host_frontend_input_t input_callback;
+
+/*---------------------------------------------------------------------------*/
+static void
+to_peer(uip_ipaddr_t *peer, const struct sockaddr_in *sin)
+{
+  memset(peer, 0, sizeof(*peer));
+  memcpy(&peer->u8[8], &sin->sin_port, 2);
+  peer->u8[10] = 0xff;
+  peer->u8[11] = 0xff;
+  memcpy(&peer->u8[12], &sin->sin_addr, 4);
+}
+/*---------------------------------------------------------------------------*/
+static void
+from_peer(struct sockaddr_in *sin, const uip_ipaddr_t *peer)
+{
+  memset(sin, 0, sizeof(*sin));
+  sin->sin_family = AF_INET;
+  memcpy(&sin->sin_port, &peer->u8[8], 2);
+  memcpy(&sin->sin_addr, &peer->u8[12], 4);
+}
+/*---------------------------------------------------------------------------*/
+int
+host_frontend_is_peer(const uip_ipaddr_t *addr)
+{
+  static const uint8_t zero[8];
+
+  return memcmp(addr->u8, zero, sizeof(zero)) == 0 &&
+    addr->u8[10] == 0xff && addr->u8[11] == 0xff;
+}
+/*---------------------------------------------------------------------------*/
+int
+host_frontend_send(const uip_ipaddr_t *peer, const void *data, uint16_t len)
+{
+  struct sockaddr_in sin;
+
+  from_peer(&sin, peer);
+  return sendto(sock, data, len, 0, (struct sockaddr *)&sin, sizeof(sin)) == len ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(sock, rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fd(fd_set *rset, fd_set *wset)
+{
+  uint8_t buf[UIP_BUFSIZE];
+  struct sockaddr_in sin;
+  socklen_t sin_len;
+  uip_ipaddr_t peer;
+  ssize_t n;
+
+  if(!FD_ISSET(sock, rset)) {
+    return;
+  }
+  /* Drain what is queued, the select loop only runs once per event. */
+  while(1) {
+    sin_len = sizeof(sin);
+    n = recvfrom(sock, buf, sizeof(buf), MSG_DONTWAIT,
+                 (struct sockaddr *)&sin, &sin_len);
+    if(n <= 0) {
+      return;
+    }
+    to_peer(&peer, &sin);
+    input_callback(&peer, buf, n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback host_frontend_callback = { set_fd, handle_fd };
+/*---------------------------------------------------------------------------*/
+uint16_t
+host_frontend_port(void)
+{
+  const char *v = getenv("HOST_FRONTEND_PORT");
+
+  return v != NULL ? (uint16_t)atoi(v) : HOST_FRONTEND_PORT;
+}
+/*---------------------------------------------------------------------------*/
+void
+host_frontend_init(host_frontend_input_t input)
+{
+  struct sockaddr_in sin;
+  uint16_t port;
+  int size = 1 << 20;
+
+  input_callback = input;
+  port = host_frontend_port();
+  if(port == 0) {
+    return;
+  }
+  sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if(sock < 0) {
+    perror("host-frontend: socket");
+    return;
+  }
+  /* Room for a burst from a few thousand clients. */
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(port);
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(bind(sock, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+    perror("host-frontend: bind");
+    printf("host-frontend: port %u taken, mesh only\n", port);
+    close(sock);
+    sock = -1;
+    return;
+  }
+  select_set_callback(sock, &host_frontend_callback);
+  printf("host-frontend: listening on 127.0.0.1:%u\n", port);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,69 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Host UDP socket in front of a native provider, so that tools
+ *         on the same machine (tools/cert-loadgen.c) can run flights
+ *         against it without going through the mesh.
+ *
+ *         Host peers are handed to the provider as IPv4-mapped
+ *         addresses with the UDP port in bytes 8-9, so every client
+ *         socket gets its own session.
+ */
+
+#ifndef HOST_FRONTEND_H_
+#define HOST_FRONTEND_H_
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+
+/* Host UDP port to listen on, 0 disables the front end. */
+#ifdef HOST_FRONTEND_CONF_PORT
+#define HOST_FRONTEND_PORT HOST_FRONTEND_CONF_PORT
+#else
+#define HOST_FRONTEND_PORT 0
+#endif
+
+typedef void (*host_frontend_input_t)(const uip_ipaddr_t *peer,
+                                      uint8_t *data, uint16_t len);
+
+/* Port in use: HOST_FRONTEND_PORT, or the HOST_FRONTEND_PORT environment
+   variable when set, so several providers on one host do not collide. */
+uint16_t host_frontend_port(void);
+
+/* Listens on host_frontend_port(); without it (0, or the bind fails)
+   the provider runs on the mesh alone. */
+void host_frontend_init(host_frontend_input_t input);
+
+/* Returns 1 if addr stands for a host peer. */
+int host_frontend_is_peer(const uip_ipaddr_t *addr);
+
+/* Sends a datagram to a host peer. Returns 0 on success. */
+int host_frontend_send(const uip_ipaddr_t *peer, const void *data, uint16_t len);
+
+#endif /* HOST_FRONTEND_H_ */
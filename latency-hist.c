@@ -0,0 +1,151 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Per-originator, per-hop latency histograms.
+ */
+
+#include "contiki.h"
+#include "net/rime/timesynch.h"
+#include "latency-hist.h"
+#include "ram-mon.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if LATENCY_HIST_ENABLED
+
+struct latency_hist {
+  uint16_t originator;
+  uint8_t hops;
+  uint8_t used;
+  uint16_t max;
+  uint16_t count[LATENCY_HIST_BUCKETS];
+};
+
+static struct latency_hist hists[LATENCY_HIST_ENTRIES];
+RAM_POOL(hist_pool, "lat entries", LATENCY_HIST_ENTRIES,
+         sizeof(struct latency_hist));
+/* Packets that found the table full, or arrived "before" they left. */
+static uint16_t untracked, unsynced;
+
+/*---------------------------------------------------------------------------*/
+static uint8_t
+bucket_of(uint16_t latency)
+{
+  uint8_t b = 0;
+
+  while(latency != 0) {
+    latency >>= 1;
+    b++;
+  }
+  return b;
+}
+/*---------------------------------------------------------------------------*/
+static struct latency_hist *
+lookup(uint16_t originator, uint8_t hops)
+{
+  struct latency_hist *h;
+  int i;
+
+  for(i = 0; i < LATENCY_HIST_ENTRIES; i++) {
+    h = &hists[i];
+    if(!h->used) {
+      h->used = 1;
+      h->originator = originator;
+      h->hops = hops;
+      ram_pool_set(&hist_pool, i + 1);
+      return h;
+    }
+    if(h->originator == originator && h->hops == hops) {
+      return h;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+latency_hist_add(const linkaddr_t *originator, uint8_t hops,
+                 uint16_t sent_time)
+{
+  struct latency_hist *h;
+  uint16_t latency;
+  uint8_t b;
+
+  latency = (uint16_t)timesynch_time() - sent_time;
+  if(latency & 0x8000) {
+    /* Negative: the originator is not synchronized yet. */
+    unsynced++;
+    return;
+  }
+  h = lookup(originator->u8[0] + (originator->u8[1] << 8), hops);
+  if(h == NULL) {
+    untracked++;
+    return;
+  }
+  b = bucket_of(latency);
+  if(h->count[b] != 0xffff) {
+    h->count[b]++;
+  }
+  if(latency > h->max) {
+    h->max = latency;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+latency_hist_reset(void)
+{
+  memset(hists, 0, sizeof(hists));
+  ram_pool_set(&hist_pool, 0);
+  untracked = 0;
+  unsynced = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+latency_hist_dump(void)
+{
+  struct latency_hist *h;
+  int i, b;
+
+  printf("lat: originator hops max b0..b%u, bucket i < 2^i ticks, %lu ticks/s\n",
+         LATENCY_HIST_BUCKETS - 1, (unsigned long)RTIMER_SECOND);
+  for(i = 0; i < LATENCY_HIST_ENTRIES; i++) {
+    h = &hists[i];
+    if(!h->used) {
+      break;
+    }
+    printf("lat %u %u %u", h->originator, h->hops, h->max);
+    for(b = 0; b < LATENCY_HIST_BUCKETS; b++) {
+      printf(" %u", h->count[b]);
+    }
+    printf("\n");
+  }
+  printf("lat: untracked [%u] unsynced [%u]\n", untracked, unsynced);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* LATENCY_HIST_ENABLED */
@@ -0,0 +1,79 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         One-way latency histograms kept by the sink/provider, per
+ *         originator and hop count. Latency is the timesynch time at
+ *         reception minus the timesynch time the originator put in its
+ *         collect-view header, so it needs TIMESYNCH_CONF_ENABLED (see
+ *         platform/sky/contiki-conf.h).
+ *
+ *         Bucket 0 counts zero latency, bucket i (i > 0) latencies of
+ *         2^(i-1) to 2^i - 1 rtimer ticks. Dumped with the "lat" serial
+ *         command.
+ */
+
+#ifndef LATENCY_HIST_H_
+#define LATENCY_HIST_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+
+#ifdef LATENCY_HIST_CONF_ENABLED
+#define LATENCY_HIST_ENABLED LATENCY_HIST_CONF_ENABLED
+#elif defined(TIMESYNCH_CONF_ENABLED)
+#define LATENCY_HIST_ENABLED TIMESYNCH_CONF_ENABLED
+#else
+#define LATENCY_HIST_ENABLED 0
+#endif
+
+/* (originator, hops) pairs tracked; later pairs are only counted. */
+#ifdef LATENCY_HIST_CONF_ENTRIES
+#define LATENCY_HIST_ENTRIES LATENCY_HIST_CONF_ENTRIES
+#elif CONTIKI_TARGET_NATIVE
+#define LATENCY_HIST_ENTRIES 256
+#else
+#define LATENCY_HIST_ENTRIES 16
+#endif
+
+/* Timesynch time is 16 bits wide: zero plus one bucket per bit. */
+#define LATENCY_HIST_BUCKETS 17
+
+#if LATENCY_HIST_ENABLED
+/* Adds one packet whose collect-view header carried sent_time. */
+void latency_hist_add(const linkaddr_t *originator, uint8_t hops,
+                      uint16_t sent_time);
+void latency_hist_reset(void);
+void latency_hist_dump(void);
+#else /* LATENCY_HIST_ENABLED */
+#define latency_hist_add(originator, hops, sent_time)
+#define latency_hist_reset()
+#define latency_hist_dump() printf("lat: needs TIMESYNCH_CONF_ENABLED\n")
+#endif /* LATENCY_HIST_ENABLED */
+
+#endif /* LATENCY_HIST_H_ */
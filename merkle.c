@@ -0,0 +1,192 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Merkle tree over a batch of handshake transcripts.
+ */
+
+#include "merkle.h"
+
+#include <string.h>
+
+/* Domain separation so a leaf can never be taken for an inner node. */
+#define MERKLE_LEAF_PREFIX 0x00
+#define MERKLE_NODE_PREFIX 0x01
+
+/*---------------------------------------------------------------------------*/
+void
+merkle_leaf_begin(SHA256_CTX *ctx)
+{
+  BYTE prefix = MERKLE_LEAF_PREFIX;
+
+  sha256_init(ctx);
+  sha256_update(ctx, &prefix, 1);
+}
+/*---------------------------------------------------------------------------*/
+void
+merkle_leaf_hash(const uint8_t *data, uint16_t len,
+                 uint8_t leaf[MERKLE_HASH_LEN])
+{
+  SHA256_CTX ctx;
+
+  merkle_leaf_begin(&ctx);
+  sha256_update(&ctx, data, len);
+  sha256_final(&ctx, leaf);
+}
+/*---------------------------------------------------------------------------*/
+static void
+node_hash(const uint8_t *left, const uint8_t *right, uint8_t *out)
+{
+  SHA256_CTX ctx;
+  BYTE prefix = MERKLE_NODE_PREFIX;
+
+  sha256_init(&ctx);
+  sha256_update(&ctx, &prefix, 1);
+  sha256_update(&ctx, left, MERKLE_HASH_LEN);
+  sha256_update(&ctx, right, MERKLE_HASH_LEN);
+  sha256_final(&ctx, out);
+}
+/*---------------------------------------------------------------------------*/
+void
+merkle_batch_reset(struct merkle_batch *batch)
+{
+  batch->count = 0;
+  batch->width = 0;
+  batch->depth = 0;
+  batch->sealed = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+merkle_batch_add(struct merkle_batch *batch,
+                 const uint8_t leaf[MERKLE_HASH_LEN])
+{
+  if(batch->sealed || batch->count >= MERKLE_MAX_LEAVES) {
+    return -1;
+  }
+  /* Leaves are staged at the bottom of the full size tree and moved
+     down to the real width when the batch is sealed. */
+  memcpy(batch->nodes[MERKLE_MAX_LEAVES + batch->count], leaf, MERKLE_HASH_LEN);
+  return batch->count++;
+}
+/*---------------------------------------------------------------------------*/
+void
+merkle_batch_seal(struct merkle_batch *batch)
+{
+  uint8_t i;
+
+  /* Smallest power of two that holds all leaves keeps paths short for
+     batches that were cut by the timer. */
+  batch->width = 1;
+  batch->depth = 0;
+  while(batch->width < batch->count) {
+    batch->width <<= 1;
+    batch->depth++;
+  }
+
+  if(batch->width != MERKLE_MAX_LEAVES) {
+    memmove(batch->nodes[batch->width], batch->nodes[MERKLE_MAX_LEAVES],
+            batch->count * MERKLE_HASH_LEN);
+  }
+  /* Unused leaves are all-zero, which no leaf hash can produce. */
+  for(i = batch->count; i < batch->width; i++) {
+    memset(batch->nodes[batch->width + i], 0, MERKLE_HASH_LEN);
+  }
+  /* With a single leaf, node 1 is the leaf and also the root. */
+  for(i = batch->width - 1; i >= 1; i--) {
+    node_hash(batch->nodes[2 * i], batch->nodes[2 * i + 1], batch->nodes[i]);
+  }
+  batch->sealed = 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+merkle_batch_proof(const struct merkle_batch *batch, uint8_t index,
+                   struct merkle_proof *proof)
+{
+  uint8_t node;
+  uint8_t level;
+
+  if(!batch->sealed || index >= batch->count) {
+    return 0;
+  }
+  proof->index = index;
+  proof->depth = batch->depth;
+  memcpy(proof->root, batch->nodes[1], MERKLE_HASH_LEN);
+
+  node = batch->width + index;
+  for(level = 0; level < batch->depth; level++) {
+    memcpy(proof->path[level], batch->nodes[node ^ 1], MERKLE_HASH_LEN);
+    node >>= 1;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+merkle_proof_write(const struct merkle_proof *proof, uint8_t *buf)
+{
+  buf[0] = proof->index;
+  buf[1] = proof->depth;
+  memcpy(buf + 2, proof->root, MERKLE_HASH_LEN);
+  memcpy(buf + 2 + MERKLE_HASH_LEN, proof->path, proof->depth * MERKLE_HASH_LEN);
+  return MERKLE_PROOF_LEN(proof->depth);
+}
+/*---------------------------------------------------------------------------*/
+int
+merkle_proof_read(struct merkle_proof *proof, const uint8_t *buf, uint16_t len)
+{
+  if(len < 2 || buf[1] > MERKLE_MAX_DEPTH ||
+     len < MERKLE_PROOF_LEN(buf[1]) || buf[0] >= (1 << buf[1])) {
+    return 0;
+  }
+  proof->index = buf[0];
+  proof->depth = buf[1];
+  memcpy(proof->root, buf + 2, MERKLE_HASH_LEN);
+  memcpy(proof->path, buf + 2 + MERKLE_HASH_LEN, proof->depth * MERKLE_HASH_LEN);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+merkle_verify(const uint8_t leaf[MERKLE_HASH_LEN],
+              const struct merkle_proof *proof)
+{
+  uint8_t acc[MERKLE_HASH_LEN];
+  uint8_t index;
+  uint8_t level;
+
+  memcpy(acc, leaf, MERKLE_HASH_LEN);
+  index = proof->index;
+  for(level = 0; level < proof->depth; level++) {
+    if(index & 1) {
+      node_hash(proof->path[level], acc, acc);
+    } else {
+      node_hash(acc, proof->path[level], acc);
+    }
+    index >>= 1;
+  }
+  return memcmp(acc, proof->root, MERKLE_HASH_LEN) == 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,132 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Merkle tree over a batch of handshake transcripts. The provider
+ *         signs only the root of each batch; a client checks its own
+ *         leaf with a log2(N) SHA-256 authentication path plus a single
+ *         signature over the root.
+ */
+
+#ifndef MERKLE_H_
+#define MERKLE_H_
+
+#include <stdint.h>
+#include "sha256.h"
+
+/* Provider signs one root per batch instead of one transcript per client. */
+#ifdef MERKLE_BATCH_CONF_ENABLED
+#define MERKLE_BATCH_ENABLED MERKLE_BATCH_CONF_ENABLED
+#else
+#define MERKLE_BATCH_ENABLED 0
+#endif
+
+/* Longest a partially filled batch waits before it is signed anyway. */
+#ifdef MERKLE_CONF_BATCH_WINDOW
+#define MERKLE_BATCH_WINDOW MERKLE_CONF_BATCH_WINDOW
+#else
+#define MERKLE_BATCH_WINDOW (CLOCK_SECOND * 5)
+#endif
+
+/* Number of leaves per batch. Must be a power of two. */
+#ifdef MERKLE_CONF_MAX_LEAVES
+#define MERKLE_MAX_LEAVES MERKLE_CONF_MAX_LEAVES
+#else
+#define MERKLE_MAX_LEAVES 8
+#endif
+
+#if MERKLE_MAX_LEAVES <= 2
+#define MERKLE_MAX_DEPTH 1
+#elif MERKLE_MAX_LEAVES <= 4
+#define MERKLE_MAX_DEPTH 2
+#elif MERKLE_MAX_LEAVES <= 8
+#define MERKLE_MAX_DEPTH 3
+#elif MERKLE_MAX_LEAVES <= 16
+#define MERKLE_MAX_DEPTH 4
+#elif MERKLE_MAX_LEAVES <= 32
+#define MERKLE_MAX_DEPTH 5
+#else
+#error "MERKLE_MAX_LEAVES: the proof and root signature must fit in one flight fragment"
+#endif
+
+#define MERKLE_HASH_LEN SHA256_BLOCK_SIZE
+
+/*
+ * The last reply fragment of a batched flight carries MERKLE_PROOF_TAG
+ * followed by the proof: [index][depth][root][path...], and then the
+ * provider's signature over the root (MERKLE_HASH_LEN bytes, see
+ * cert_root_sign()).
+ */
+#define MERKLE_PROOF_TAG 'M'
+#define MERKLE_PROOF_LEN(depth) (2 + MERKLE_HASH_LEN * (1 + (depth)))
+
+struct merkle_proof {
+  uint8_t index;
+  uint8_t depth;
+  uint8_t root[MERKLE_HASH_LEN];
+  uint8_t path[MERKLE_MAX_DEPTH][MERKLE_HASH_LEN];
+};
+
+struct merkle_batch {
+  /* Implicit binary heap: node 1 is the root, leaves start at width. */
+  uint8_t nodes[2 * MERKLE_MAX_LEAVES][MERKLE_HASH_LEN];
+  uint8_t count;
+  uint8_t width;
+  uint8_t depth;
+  uint8_t sealed;
+};
+
+/* Starts a leaf hash; feed it with sha256_update() and sha256_final(). */
+void merkle_leaf_begin(SHA256_CTX *ctx);
+void merkle_leaf_hash(const uint8_t *data, uint16_t len,
+                      uint8_t leaf[MERKLE_HASH_LEN]);
+
+void merkle_batch_reset(struct merkle_batch *batch);
+
+/* Returns the leaf index, or -1 if the batch is full or sealed. */
+int merkle_batch_add(struct merkle_batch *batch,
+                     const uint8_t leaf[MERKLE_HASH_LEN]);
+
+/* Builds the tree over the leaves added so far and freezes the batch. */
+void merkle_batch_seal(struct merkle_batch *batch);
+
+int merkle_batch_proof(const struct merkle_batch *batch, uint8_t index,
+                       struct merkle_proof *proof);
+
+/* Serializes a proof without the tag, returns its length in bytes. */
+uint16_t merkle_proof_write(const struct merkle_proof *proof, uint8_t *buf);
+
+/* Parses a proof, returns 0 if the buffer is malformed. */
+int merkle_proof_read(struct merkle_proof *proof, const uint8_t *buf,
+                      uint16_t len);
+
+/* Returns 1 if leaf hashes up to proof->root along proof->path. */
+int merkle_verify(const uint8_t leaf[MERKLE_HASH_LEN],
+                  const struct merkle_proof *proof);
+
+#endif /* MERKLE_H_ */
@@ -0,0 +1,404 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Nearest provider selection.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ip/uip-udp-packet.h"
+#include "net/rpl/rpl.h"
+#include "provider-select.h"
+#include "cert-crypto.h"
+#include "scratch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if PROVIDER_SELECT_ENABLED
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+#define MSG_SOLICIT 'S'
+#define MSG_ADVERT  'A'
+#define ADVERT_HDR_LEN 2
+
+#define STATE_FREE    0
+#define STATE_PROBING 1
+#define STATE_UP      2
+#define STATE_FAILED  3
+
+struct provider {
+  uip_ipaddr_t addr;
+  /* Client: when the last probe went out. Root: last registration. */
+  clock_time_t stamp;
+  clock_time_t rtt;
+  uint8_t hops;
+  uint8_t state;
+};
+
+static struct provider providers[PROVIDER_SELECT_MAX];
+static struct uip_udp_conn *conn;
+static struct ctimer timer;
+static uip_ipaddr_t root_addr;
+static uint8_t is_client;
+
+/*---------------------------------------------------------------------------*/
+static struct provider *
+find(const uip_ipaddr_t *addr)
+{
+  int i;
+
+  for(i = 0; i < PROVIDER_SELECT_MAX; i++) {
+    if(providers[i].state != STATE_FREE &&
+       uip_ipaddr_cmp(&providers[i].addr, addr)) {
+      return &providers[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct provider *
+add(const uip_ipaddr_t *addr)
+{
+  int i;
+
+  for(i = 0; i < PROVIDER_SELECT_MAX; i++) {
+    if(providers[i].state == STATE_FREE) {
+      memset(&providers[i], 0, sizeof(providers[i]));
+      uip_ipaddr_copy(&providers[i].addr, addr);
+      return &providers[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+node_id(const uip_ipaddr_t *addr)
+{
+  return addr->u8[15] + (addr->u8[14] << 8);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send(const uint8_t *plain, uint16_t len, const uip_ipaddr_t *to, uint16_t port)
+{
+  scratch_mark_t mark;
+  uint8_t *buf;
+
+  mark = scratch_mark();
+  buf = scratch_alloc(len + CERT_CRYPTO_OVERHEAD);
+  if(buf != NULL) {
+    memcpy(buf + CERT_CRYPTO_HDR_LEN, plain, len);
+    len = cert_crypto_seal(buf, len);
+    if(len != 0) {
+      uip_udp_packet_sendto(conn, buf, len, to, UIP_HTONS(port));
+    }
+  }
+  scratch_release(mark);
+}
+/*---------------------------------------------------------------------------*/
+/* The root lists its live registrations, any other provider itself only. */
+static void
+advertise(const uip_ipaddr_t *to, uint16_t port)
+{
+  uint8_t msg[ADVERT_HDR_LEN + PROVIDER_SELECT_MAX * sizeof(uip_ipaddr_t)];
+  uint8_t count;
+  int i;
+
+  count = 0;
+  if(provider_select_is_root()) {
+    for(i = 0; i < PROVIDER_SELECT_MAX; i++) {
+      if(providers[i].state == STATE_FREE) {
+        continue;
+      }
+      if(clock_time() - providers[i].stamp > 3 * PROVIDER_SELECT_INTERVAL) {
+        printf("providers: [%u] expired\n", node_id(&providers[i].addr));
+        providers[i].state = STATE_FREE;
+        continue;
+      }
+      memcpy(msg + ADVERT_HDR_LEN + count * sizeof(uip_ipaddr_t),
+             &providers[i].addr, sizeof(uip_ipaddr_t));
+      count++;
+    }
+  }
+  msg[0] = MSG_ADVERT;
+  msg[1] = count;
+  send(msg, ADVERT_HDR_LEN + count * sizeof(uip_ipaddr_t), to, port);
+}
+/*---------------------------------------------------------------------------*/
+static void
+register_timeout(void *ptr)
+{
+  advertise(&root_addr, PROVIDER_SELECT_PROVIDER_PORT);
+  ctimer_set(&timer, PROVIDER_SELECT_INTERVAL, register_timeout, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+probe(const uip_ipaddr_t *addr)
+{
+  struct provider *p;
+  uint8_t msg;
+
+  p = find(addr);
+  if(p == NULL && (p = add(addr)) == NULL) {
+    return;
+  }
+  p->stamp = clock_time();
+  if(p->state != STATE_UP) {
+    p->state = STATE_PROBING;
+  }
+  msg = MSG_SOLICIT;
+  send(&msg, 1, addr, PROVIDER_SELECT_PROVIDER_PORT);
+}
+/*---------------------------------------------------------------------------*/
+static int
+any_up(void)
+{
+  int i;
+
+  for(i = 0; i < PROVIDER_SELECT_MAX; i++) {
+    if(providers[i].state == STATE_UP) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Forgets failed providers and asks the root for the registry again. */
+static void
+refresh(void *ptr)
+{
+  int i;
+
+  for(i = 0; i < PROVIDER_SELECT_MAX; i++) {
+    if(providers[i].state == STATE_FAILED) {
+      providers[i].state = STATE_FREE;
+    }
+  }
+  probe(&root_addr);
+  /* Until some provider answered, keep asking at the registration rate. */
+  ctimer_set(&timer, any_up() ? PROVIDER_SELECT_REFRESH : PROVIDER_SELECT_INTERVAL,
+             refresh, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+advert_input(const uip_ipaddr_t *from, const uint8_t *msg, int len, uint8_t hops)
+{
+  struct provider *p;
+  uip_ipaddr_t addr;
+  uint8_t i;
+
+  if(len < ADVERT_HDR_LEN ||
+     len != ADVERT_HDR_LEN + msg[1] * sizeof(uip_ipaddr_t)) {
+    return;
+  }
+  if(!is_client) {
+    /* A registration; only the root keeps them. */
+    if(provider_select_is_root() &&
+       ((p = find(from)) != NULL || (p = add(from)) != NULL)) {
+      if(p->state == STATE_FREE) {
+        printf("providers: [%u] registered\n", node_id(from));
+      }
+      p->state = STATE_UP;
+      p->stamp = clock_time();
+    }
+    return;
+  }
+  p = find(from);
+  if(p == NULL || p->state == STATE_FAILED) {
+    return;
+  }
+  p->rtt = clock_time() - p->stamp;
+  p->hops = hops;
+  p->state = STATE_UP;
+  for(i = 0; i < msg[1]; i++) {
+    memcpy(&addr, msg + ADVERT_HDR_LEN + i * sizeof(uip_ipaddr_t), sizeof(addr));
+    if(find(&addr) == NULL) {
+      probe(&addr);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+provider_select_is_root(void)
+{
+  return linkaddr_node_addr.u8[LINKADDR_SIZE - 1] == PROVIDER_SELECT_ROOT_ID;
+}
+/*---------------------------------------------------------------------------*/
+void
+provider_select_provider_init(void)
+{
+  uip_ip6addr(&root_addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+  conn = udp_new(NULL, 0, NULL);
+  udp_bind(conn, UIP_HTONS(PROVIDER_SELECT_PROVIDER_PORT));
+  if(!provider_select_is_root()) {
+    /* First registration once the DODAG had a chance to form. */
+    ctimer_set(&timer, PROVIDER_SELECT_INTERVAL / 4, register_timeout, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+provider_select_client_init(void)
+{
+  is_client = 1;
+  uip_ip6addr(&root_addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+  conn = udp_new(NULL, 0, NULL);
+  udp_bind(conn, UIP_HTONS(PROVIDER_SELECT_CLIENT_PORT));
+  ctimer_set(&timer, PROVIDER_SELECT_INTERVAL / 2, refresh, NULL);
+}
+/*---------------------------------------------------------------------------*/
+struct uip_udp_conn *
+provider_select_conn(void)
+{
+  return conn;
+}
+/*---------------------------------------------------------------------------*/
+void
+provider_select_input(void)
+{
+  uip_ipaddr_t from;
+  uint8_t *plain;
+  uint8_t hops;
+  int len;
+
+  if(!uip_newdata()) {
+    return;
+  }
+  uip_ipaddr_copy(&from, &UIP_IP_BUF->srcipaddr);
+  hops = uip_ds6_if.cur_hop_limit - UIP_IP_BUF->ttl + 1;
+  len = cert_crypto_open(uip_appdata, uip_datalen());
+  if(len < 1) {
+    return;
+  }
+  plain = (uint8_t *)uip_appdata + CERT_CRYPTO_HDR_LEN;
+  if(plain[0] == MSG_SOLICIT && !is_client) {
+    advertise(&from, PROVIDER_SELECT_CLIENT_PORT);
+  } else if(plain[0] == MSG_ADVERT) {
+    advert_input(&from, plain, len, hops);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The live provider with the fewest hops, other than except. */
+static struct provider *
+best_except(const uip_ipaddr_t *except)
+{
+  struct provider *b;
+  int i;
+
+  b = NULL;
+  for(i = 0; i < PROVIDER_SELECT_MAX; i++) {
+    if(providers[i].state != STATE_UP ||
+       (except != NULL && uip_ipaddr_cmp(&providers[i].addr, except))) {
+      continue;
+    }
+    if(b == NULL || providers[i].hops < b->hops ||
+       (providers[i].hops == b->hops && providers[i].rtt < b->rtt)) {
+      b = &providers[i];
+    }
+  }
+  return b;
+}
+/*---------------------------------------------------------------------------*/
+static struct provider *
+best(void)
+{
+  return best_except(NULL);
+}
+/*---------------------------------------------------------------------------*/
+const uip_ipaddr_t *
+provider_select_current(void)
+{
+  struct provider *b;
+
+  b = best();
+  return b != NULL ? &b->addr : &root_addr;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+provider_select_hops(void)
+{
+  struct provider *b;
+  rpl_dag_t *dag;
+
+  b = best();
+  if(b != NULL) {
+    return b->hops;
+  }
+  /* Nothing probed yet: the root, as far as the DODAG rank tells. */
+  dag = rpl_get_any_dag();
+  if(dag != NULL && dag->instance != NULL) {
+    return DAG_RANK(dag->rank, dag->instance);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const uip_ipaddr_t *
+provider_select_other(const uip_ipaddr_t *addr)
+{
+  struct provider *b;
+
+  b = best_except(addr);
+  return b != NULL ? &b->addr : NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+provider_select_failed(const uip_ipaddr_t *addr)
+{
+  struct provider *p;
+
+  p = find(addr);
+  if(p == NULL && (p = add(addr)) == NULL) {
+    return;
+  }
+  p->state = STATE_FAILED;
+  if(!any_up()) {
+    /* Nobody left, start over from the root. */
+    refresh(NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+provider_select_stats(void)
+{
+  static const char *const names[] = { "free", "probing", "up", "failed" };
+  int i;
+
+  for(i = 0; i < PROVIDER_SELECT_MAX; i++) {
+    if(providers[i].state == STATE_FREE) {
+      continue;
+    }
+    printf("providers: [%u] hops [%u] rtt [%lu] ms %s\n",
+           node_id(&providers[i].addr), providers[i].hops,
+           (unsigned long)providers[i].rtt * 1000 / CLOCK_SECOND,
+           names[providers[i].state]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* PROVIDER_SELECT_ENABLED */
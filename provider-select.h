@@ -0,0 +1,122 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Nearest provider selection. Provider PROVIDER_SELECT_ROOT_ID
+ *         roots the DODAG as aaaa::1 and keeps a registry of the other
+ *         providers, which join the DODAG as routers and register with
+ *         the root every PROVIDER_SELECT_INTERVAL.
+ *
+ *         A client solicits the root, gets the registry back and probes
+ *         every provider on it. Each answer gives the hop count (from the
+ *         remaining hop limit) and the round trip time; the client runs
+ *         its flights against the provider with the fewest hops, the
+ *         lower RTT breaking ties. Before any answer arrived the root is
+ *         used, and a provider that misses a reply timeout is skipped
+ *         until the next refresh.
+ *
+ *         Messages are sealed with the flight key like everything else:
+ *
+ *           SOLICIT  ['S']
+ *           ADVERT   ['A'][count (1)] { [address (16)] }*
+ *
+ *         A provider answers a SOLICIT with an ADVERT, the root's lists
+ *         the registered providers. An ADVERT sent to the root registers
+ *         its sender.
+ */
+
+#ifndef PROVIDER_SELECT_H_
+#define PROVIDER_SELECT_H_
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+
+#ifdef PROVIDER_SELECT_CONF_ENABLED
+#define PROVIDER_SELECT_ENABLED PROVIDER_SELECT_CONF_ENABLED
+#else
+#define PROVIDER_SELECT_ENABLED 0
+#endif
+
+/* Providers known to a client or registered with the root. */
+#ifdef PROVIDER_SELECT_CONF_MAX
+#define PROVIDER_SELECT_MAX PROVIDER_SELECT_CONF_MAX
+#else
+#define PROVIDER_SELECT_MAX 4
+#endif
+
+/* Last link address byte (the node id in Cooja) of the root provider. */
+#ifdef PROVIDER_SELECT_CONF_ROOT_ID
+#define PROVIDER_SELECT_ROOT_ID PROVIDER_SELECT_CONF_ROOT_ID
+#else
+#define PROVIDER_SELECT_ROOT_ID 1
+#endif
+
+/* Registration period; the root drops a provider after three missed. */
+#ifdef PROVIDER_SELECT_CONF_INTERVAL
+#define PROVIDER_SELECT_INTERVAL PROVIDER_SELECT_CONF_INTERVAL
+#else
+#define PROVIDER_SELECT_INTERVAL (CLOCK_SECOND * 60)
+#endif
+
+/* How often a client solicits the root again and retries failed ones. */
+#ifdef PROVIDER_SELECT_CONF_REFRESH
+#define PROVIDER_SELECT_REFRESH PROVIDER_SELECT_CONF_REFRESH
+#else
+#define PROVIDER_SELECT_REFRESH (CLOCK_SECOND * 600)
+#endif
+
+#define PROVIDER_SELECT_CLIENT_PORT   8777
+#define PROVIDER_SELECT_PROVIDER_PORT 5690
+
+/* 1 on the provider that roots the DODAG. */
+int provider_select_is_root(void);
+
+/* Call from the provider and the client process respectively. */
+void provider_select_provider_init(void);
+void provider_select_client_init(void);
+
+/* tcpip_event on the connection below. */
+void provider_select_input(void);
+struct uip_udp_conn *provider_select_conn(void);
+
+/* Client: the provider to use for the next flight. */
+const uip_ipaddr_t *provider_select_current(void);
+
+/* Client: hop count of the current provider, 0 if not measured yet. */
+uint8_t provider_select_hops(void);
+
+/* Client: the best live provider other than addr, or NULL. */
+const uip_ipaddr_t *provider_select_other(const uip_ipaddr_t *addr);
+
+/* Client: the provider missed a reply timeout, use the next best. */
+void provider_select_failed(const uip_ipaddr_t *addr);
+
+/* Known providers with hops, RTT and state. */
+void provider_select_stats(void);
+
+#endif /* PROVIDER_SELECT_H_ */
@@ -0,0 +1,229 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Stack high-water marks and static pool usage.
+ */
+
+#include "contiki.h"
+#include "ram-mon.h"
+#include "auth-prof.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static struct ram_pool *pools;
+
+#if RAM_MON_ENABLED
+/* Left unpainted below the sampling frame for paint()'s own frame. */
+#define MARGIN 64
+
+#if defined(__MSP430__)
+/* End of .bss; the stack grows down towards it. */
+extern int _end;
+#define STACK_BOTTOM ((uint8_t *)&_end + 16)
+#else
+#define STACK_BOTTOM (top - RAM_MON_STACK_SIZE)
+#endif
+
+static uint8_t *top, *bottom;
+static uint16_t stack_max;
+static uint8_t overflow;
+
+static uint8_t open_phases;
+static uint16_t phase_run[AUTH_PROF_PHASES];
+static uint16_t phase_max[AUTH_PROF_PHASES];
+
+static struct {
+  struct process *p;
+  uint16_t max;
+} procs[RAM_MON_PROCESSES];
+static uint16_t other_max;
+
+/*---------------------------------------------------------------------------*/
+static void
+paint(volatile uint8_t *p, const uint8_t *end)
+{
+  /* Byte stores through volatile: memset() below a dead frame is a dead
+     store as far as the compiler is concerned. */
+  while(p < end) {
+    *p++ = RAM_MON_PAINT;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+sample(void)
+{
+  uint8_t *here;
+  uint8_t *limit;
+  volatile uint8_t *p;
+  uint16_t depth;
+  int i;
+
+  if(top == NULL) {
+    return 0;
+  }
+  here = __builtin_frame_address(0);
+  limit = here - MARGIN;
+  p = bottom;
+  while(p < limit && *p == RAM_MON_PAINT) {
+    p++;
+  }
+  if(p == bottom && p < limit) {
+    overflow = 1;
+  }
+  depth = (uint16_t)(top - (p < limit ? (uint8_t *)p : here));
+  paint(p, limit);
+
+  if(depth > stack_max) {
+    stack_max = depth;
+  }
+  for(i = 0; i < AUTH_PROF_PHASES; i++) {
+    if((open_phases & (1 << i)) && depth > phase_run[i]) {
+      phase_run[i] = depth;
+    }
+  }
+  return depth;
+}
+/*---------------------------------------------------------------------------*/
+void
+ram_mon_init(void)
+{
+  top = __builtin_frame_address(0);
+  bottom = STACK_BOTTOM;
+  paint(bottom, top - MARGIN);
+}
+/*---------------------------------------------------------------------------*/
+void
+ram_mon_phase_begin(uint8_t phase)
+{
+  /* Whatever was reached so far belongs to the enclosing phases. */
+  sample();
+  open_phases |= 1 << phase;
+  phase_run[phase] = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+ram_mon_phase_end(uint8_t phase)
+{
+  sample();
+  open_phases &= ~(1 << phase);
+  if(phase_run[phase] > phase_max[phase]) {
+    phase_max[phase] = phase_run[phase];
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+ram_mon_process(struct process *p)
+{
+  uint16_t depth;
+  int i;
+
+  depth = sample();
+  if(p != NULL) {
+    for(i = 0; i < RAM_MON_PROCESSES; i++) {
+      if(procs[i].p == NULL) {
+        procs[i].p = p;
+      }
+      if(procs[i].p == p) {
+        if(depth > procs[i].max) {
+          procs[i].max = depth;
+        }
+        return;
+      }
+    }
+  }
+  if(depth > other_max) {
+    other_max = depth;
+  }
+}
+#endif /* RAM_MON_ENABLED */
+/*---------------------------------------------------------------------------*/
+void
+ram_pool_set(struct ram_pool *p, uint16_t used)
+{
+  if(!p->registered) {
+    p->registered = 1;
+    p->next = pools;
+    pools = p;
+  }
+  p->used = used;
+  if(used > p->peak) {
+    p->peak = used;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+ram_mon_reset(void)
+{
+  struct ram_pool *p;
+
+#if RAM_MON_ENABLED
+  sample();
+  stack_max = 0;
+  memset(phase_max, 0, sizeof(phase_max));
+  memset(procs, 0, sizeof(procs));
+  other_max = 0;
+#endif /* RAM_MON_ENABLED */
+  for(p = pools; p != NULL; p = p->next) {
+    p->peak = p->used;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+ram_mon_dump(void)
+{
+  struct ram_pool *p;
+#if RAM_MON_ENABLED
+  int i;
+
+  sample();
+  printf("ram: stack max [%u] free [%u] of [%u] bytes%s\n", stack_max,
+         (uint16_t)(top - bottom) - stack_max, (uint16_t)(top - bottom),
+         overflow ? ", OVERFLOW" : "");
+#if AUTH_PROF_ENABLED
+  for(i = 0; i < AUTH_PROF_PHASES; i++) {
+    if(phase_max[i] != 0) {
+      printf("ram: phase %s [%u]\n", auth_prof_phase_name(i), phase_max[i]);
+    }
+  }
+#endif /* AUTH_PROF_ENABLED */
+  for(i = 0; i < RAM_MON_PROCESSES && procs[i].p != NULL; i++) {
+    printf("ram: process %s [%u]\n", PROCESS_NAME_STRING(procs[i].p),
+           procs[i].max);
+  }
+  printf("ram: process other [%u]\n", other_max);
+#else /* RAM_MON_ENABLED */
+  printf("ram: stack painting disabled\n");
+#endif /* RAM_MON_ENABLED */
+  for(p = pools; p != NULL; p = p->next) {
+    printf("ram: pool %s [%u] peak [%u] of [%u] x [%u] bytes\n", p->name,
+           p->used, p->peak, p->size, p->elem);
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,109 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Stack high-water marks and static pool usage, printed by the
+ *         "ram" serial command.
+ *
+ *         ram_mon_init() paints the free stack with RAM_MON_PAINT. Each
+ *         sample scans up from the bottom for the deepest overwritten
+ *         byte, folds that depth into whatever is being measured and
+ *         repaints the dirty part. Samples are taken around every
+ *         auth_prof phase and in the event loops of the application
+ *         processes, so each gets its own high-water mark. Depths are
+ *         bytes below the frame that called ram_mon_init().
+ *
+ *         Pools are the fixed-size tables (sessions, queues, rings) the
+ *         firmware sizes at compile time; each reports current and peak
+ *         use against its capacity.
+ */
+
+#ifndef RAM_MON_H_
+#define RAM_MON_H_
+
+#include "contiki.h"
+
+#ifdef RAM_MON_CONF_ENABLED
+#define RAM_MON_ENABLED RAM_MON_CONF_ENABLED
+#else
+#define RAM_MON_ENABLED 0
+#endif
+
+/* Bytes painted below the initial frame where the stack bottom is not
+   known from the linker (native). */
+#ifdef RAM_MON_CONF_STACK_SIZE
+#define RAM_MON_STACK_SIZE RAM_MON_CONF_STACK_SIZE
+#else
+#define RAM_MON_STACK_SIZE 16384
+#endif
+
+/* Distinct processes tracked; later ones are folded into "other". */
+#ifdef RAM_MON_CONF_PROCESSES
+#define RAM_MON_PROCESSES RAM_MON_CONF_PROCESSES
+#else
+#define RAM_MON_PROCESSES 4
+#endif
+
+#define RAM_MON_PAINT 0xa5
+
+struct ram_pool {
+  struct ram_pool *next;
+  const char *name;
+  uint16_t size;      /* capacity, in elements */
+  uint16_t elem;      /* bytes per element */
+  uint16_t used;
+  uint16_t peak;
+  uint8_t registered;
+};
+
+/* Declares a pool; it shows up in the dump after its first update. */
+#define RAM_POOL(var, name, size, elem) \
+  static struct ram_pool var = { NULL, name, size, elem, 0, 0, 0 }
+
+void ram_pool_set(struct ram_pool *p, uint16_t used);
+
+#if RAM_MON_ENABLED
+void ram_mon_init(void);
+/* Called by auth_prof_begin()/auth_prof_end(). */
+void ram_mon_phase_begin(uint8_t phase);
+void ram_mon_phase_end(uint8_t phase);
+/* Call with NULL when an event arrives and with PROCESS_CURRENT() once
+   it has been handled, so the depth reached in between is charged to
+   that process and everything else to "other". */
+void ram_mon_process(struct process *p);
+#else /* RAM_MON_ENABLED */
+#define ram_mon_init()
+#define ram_mon_phase_begin(phase)
+#define ram_mon_phase_end(phase)
+#define ram_mon_process(p)
+#endif /* RAM_MON_ENABLED */
+
+void ram_mon_reset(void);
+void ram_mon_dump(void);
+
+#endif /* RAM_MON_H_ */
@@ -0,0 +1,160 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Anti-replay window for flight messages.
+ */
+
+#include "contiki.h"
+#include "replay-window.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if REPLAY_WINDOW_BITS == 64
+typedef uint64_t replay_bitmap_t;
+#elif REPLAY_WINDOW_BITS == 32
+typedef uint32_t replay_bitmap_t;
+#else
+#error "REPLAY_WINDOW_BITS must be 32 or 64"
+#endif
+
+struct replay_window {
+  replay_bitmap_t seen;   /* bit i: top - i was accepted */
+  uint32_t top;
+  clock_time_t last;      /* last update, for eviction */
+  uint16_t sender;
+  uint8_t used;
+};
+static struct replay_window windows[REPLAY_WINDOW_PEERS];
+
+static unsigned long accepted;
+static unsigned long duplicates;
+static unsigned long stale;
+static unsigned long evicted;
+
+/*---------------------------------------------------------------------------*/
+static struct replay_window *
+window_find(uint16_t sender)
+{
+  int i;
+
+  for(i = 0; i < REPLAY_WINDOW_PEERS; i++) {
+    if(windows[i].used && windows[i].sender == sender) {
+      return &windows[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+replay_window_check(uint16_t sender, uint32_t counter)
+{
+  struct replay_window *w;
+  int32_t diff;
+
+  w = window_find(sender);
+  if(w == NULL) {
+    return 1;
+  }
+  diff = (int32_t)(counter - w->top);
+  if(diff > 0) {
+    return 1;
+  }
+  if(-diff >= REPLAY_WINDOW_BITS) {
+    stale++;
+    return 0;
+  }
+  if(w->seen & ((replay_bitmap_t)1 << -diff)) {
+    duplicates++;
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+replay_window_update(uint16_t sender, uint32_t counter)
+{
+  struct replay_window *w;
+  clock_time_t now;
+  int32_t diff;
+  int i;
+
+  accepted++;
+  now = clock_time();
+  w = window_find(sender);
+  if(w == NULL) {
+    /* A free slot, or the sender heard from least recently. */
+    w = &windows[0];
+    for(i = 0; i < REPLAY_WINDOW_PEERS; i++) {
+      if(!windows[i].used) {
+        w = &windows[i];
+        break;
+      }
+      if((clock_time_t)(now - windows[i].last) > (clock_time_t)(now - w->last)) {
+        w = &windows[i];
+      }
+    }
+    if(w->used) {
+      evicted++;
+    }
+    w->used = 1;
+    w->sender = sender;
+    w->top = counter;
+    w->seen = 1;
+    w->last = now;
+    return;
+  }
+  w->last = now;
+  diff = (int32_t)(counter - w->top);
+  if(diff > 0) {
+    w->seen = diff < REPLAY_WINDOW_BITS ? w->seen << diff : 0;
+    w->seen |= 1;
+    w->top = counter;
+  } else if(-diff < REPLAY_WINDOW_BITS) {
+    w->seen |= (replay_bitmap_t)1 << -diff;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+replay_window_stats(void)
+{
+  printf("replay: window [%u] peers [%u] accepted [%lu] duplicate [%lu] "
+         "stale [%lu] evicted [%lu]\n", REPLAY_WINDOW_BITS,
+         REPLAY_WINDOW_PEERS, accepted, duplicates, stale, evicted);
+}
+/*---------------------------------------------------------------------------*/
+void
+replay_window_stats_reset(void)
+{
+  accepted = 0;
+  duplicates = 0;
+  stale = 0;
+  evicted = 0;
+}
+/*---------------------------------------------------------------------------*/
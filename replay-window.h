@@ -0,0 +1,84 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Anti-replay window for flight messages (RFC 4303 style).
+ *
+ *         Windows are keyed on the sender id and seal counter of the
+ *         crypto header (cert-crypto.h). Both are the CCM nonce, so the
+ *         MIC covers them, and a sender's counter only grows, across
+ *         flights and reboots alike. Per sender the window keeps the
+ *         highest counter accepted and a bitmap of the REPLAY_WINDOW_BITS
+ *         counters below it. replay_window_check() runs before the MIC
+ *         is checked and drops duplicates and counters older than the
+ *         window; replay_window_update() moves the window only once the
+ *         MIC matched, so a rewritten header cannot shift it.
+ *
+ *         Windows outlive flights and sessions, up to REPLAY_WINDOW_PEERS
+ *         senders. A full table evicts the sender heard from least
+ *         recently, which is then accepted afresh; so is any sender
+ *         after this node restarted.
+ */
+
+#ifndef REPLAY_WINDOW_H_
+#define REPLAY_WINDOW_H_
+
+#include "contiki.h"
+
+#ifdef REPLAY_WINDOW_CONF_ENABLED
+#define REPLAY_WINDOW_ENABLED REPLAY_WINDOW_CONF_ENABLED
+#else
+#define REPLAY_WINDOW_ENABLED 1
+#endif
+
+/* 32 or 64. */
+#ifdef REPLAY_WINDOW_CONF_BITS
+#define REPLAY_WINDOW_BITS REPLAY_WINDOW_CONF_BITS
+#else
+#define REPLAY_WINDOW_BITS 32
+#endif
+
+/* Senders tracked at once. */
+#ifdef REPLAY_WINDOW_CONF_PEERS
+#define REPLAY_WINDOW_PEERS REPLAY_WINDOW_CONF_PEERS
+#else
+#define REPLAY_WINDOW_PEERS 16
+#endif
+
+/* 1 if counter may be new from sender, 0 (and counted) for a duplicate
+   or stale one. */
+int replay_window_check(uint16_t sender, uint32_t counter);
+
+/* Marks counter from sender as seen, after its MIC matched. */
+void replay_window_update(uint16_t sender, uint32_t counter);
+
+/* Drop counters, for the "replay" serial command. */
+void replay_window_stats(void);
+void replay_window_stats_reset(void);
+
+#endif /* REPLAY_WINDOW_H_ */
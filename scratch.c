@@ -0,0 +1,84 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Scratch arena for the authentication pipeline.
+ */
+
+#include "contiki.h"
+#include "scratch.h"
+#include "ram-mon.h"
+
+#include <stdio.h>
+
+/* Enough for SHA256_CTX's 64-bit bit count on native. */
+#define ALIGN sizeof(void *)
+
+static union {
+  uint8_t bytes[SCRATCH_SIZE];
+  void *align;
+} arena;
+static uint16_t top;
+static uint16_t failed;
+
+RAM_POOL(scratch_pool, "scratch", SCRATCH_SIZE, 1);
+
+/*---------------------------------------------------------------------------*/
+scratch_mark_t
+scratch_mark(void)
+{
+  return top;
+}
+/*---------------------------------------------------------------------------*/
+void *
+scratch_alloc(uint16_t size)
+{
+  void *p;
+
+  size = (size + ALIGN - 1) & ~(ALIGN - 1);
+  if(size > SCRATCH_SIZE - top) {
+    failed++;
+    printf("scratch: [%u] B requested, [%u] free, [%u] failures\n",
+           size, SCRATCH_SIZE - top, failed);
+    return NULL;
+  }
+  p = &arena.bytes[top];
+  top += size;
+  ram_pool_set(&scratch_pool, top);
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+void
+scratch_release(scratch_mark_t mark)
+{
+  if(mark < top) {
+    top = mark;
+    ram_pool_set(&scratch_pool, top);
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,69 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Scratch arena for the authentication pipeline. Hashing,
+ *         verification and fragment building take their temporary
+ *         buffers from one static array instead of the stack:
+ *
+ *           scratch_mark_t mark = scratch_mark();
+ *           msg = scratch_alloc(sizeof(*msg));
+ *           ...
+ *           scratch_release(mark);
+ *
+ *         Allocations are released in reverse order by rolling back to
+ *         a mark, so nested phases simply stack on top of each other and
+ *         the peak is fixed by the deepest nesting. The arena is in .bss
+ *         and shows up in "make ram-report"; its live peak is the
+ *         "scratch" pool of the "ram" command. Not thread safe: the
+ *         native gateway workers use the *_mt functions, which do not
+ *         touch it.
+ */
+
+#ifndef SCRATCH_H_
+#define SCRATCH_H_
+
+#include "contiki.h"
+
+/* Deepest nesting is a fragment message (302 B) built while a SHA-256
+   context (Merkle leaf, ~112 B) is live, or a context, digest and the
+   sealed 142 B verify buffer on the provider. */
+#ifdef SCRATCH_CONF_SIZE
+#define SCRATCH_SIZE SCRATCH_CONF_SIZE
+#else
+#define SCRATCH_SIZE 512
+#endif
+
+typedef uint16_t scratch_mark_t;
+
+scratch_mark_t scratch_mark(void);
+/* Returns NULL, after logging, if the arena is exhausted. */
+void *scratch_alloc(uint16_t size);
+void scratch_release(scratch_mark_t mark);
+
+#endif /* SCRATCH_H_ */
@@ -0,0 +1,381 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Multi-buffer SHA-256.
+ */
+
+#include "contiki.h"
+#include "sha256-mb.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SHA256_MB_X86 1
+#include <immintrin.h>
+#else
+#define SHA256_MB_X86 0
+#endif
+
+#if SHA256_MB_X86
+static const uint32_t k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t h0[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/* Per lane view of a message as a sequence of padded 64 byte blocks. */
+struct lane {
+  const uint8_t *msg;
+  size_t len;
+  size_t nblocks;
+  uint8_t tail[128];
+  size_t tail_start;
+};
+/*---------------------------------------------------------------------------*/
+static void
+lane_init(struct lane *l, const uint8_t *msg, size_t len)
+{
+  unsigned long long bits;
+  size_t rest;
+  int i;
+
+  l->msg = msg;
+  l->len = len;
+  l->nblocks = (len + 9 + 63) / 64;
+  /* The last one or two blocks hold the end of the message and padding. */
+  l->tail_start = (len / 64) * 64;
+  rest = len - l->tail_start;
+  memset(l->tail, 0, sizeof(l->tail));
+  memcpy(l->tail, msg + l->tail_start, rest);
+  l->tail[rest] = 0x80;
+  bits = (unsigned long long)len * 8;
+  for(i = 0; i < 8; i++) {
+    l->tail[(l->nblocks * 64 - l->tail_start) - 1 - i] = (uint8_t)(bits >> (8 * i));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const uint8_t *
+lane_block(const struct lane *l, size_t b)
+{
+  if(b >= l->nblocks) {
+    /* Lane already finished: feed anything, its state is not used. */
+    return l->tail;
+  }
+  if(b * 64 < l->tail_start) {
+    return l->msg + b * 64;
+  }
+  return l->tail + (b * 64 - l->tail_start);
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+load_be32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_digest(uint8_t *out, const uint32_t *state, unsigned stride)
+{
+  int i;
+
+  for(i = 0; i < 8; i++) {
+    out[4 * i] = (uint8_t)(state[i * stride] >> 24);
+    out[4 * i + 1] = (uint8_t)(state[i * stride] >> 16);
+    out[4 * i + 2] = (uint8_t)(state[i * stride] >> 8);
+    out[4 * i + 3] = (uint8_t)state[i * stride];
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * The same round code is instantiated for both vector widths. VEC is the
+ * vector type, the other macros map onto the matching intrinsics.
+ */
+#define SHA256_MB_ROUNDS(VEC, ADD, XOR, AND, ANDNOT, OR, SRL, SLL, SET1) \
+  do { \
+    VEC a = st[0], b = st[1], c = st[2], d = st[3]; \
+    VEC e = st[4], f = st[5], g = st[6], h = st[7]; \
+    VEC t1, t2, s0, s1; \
+    int t; \
+    for(t = 16; t < 64; t++) { \
+      s0 = XOR(XOR(OR(SRL(w[t - 15], 7), SLL(w[t - 15], 25)), \
+                   OR(SRL(w[t - 15], 18), SLL(w[t - 15], 14))), \
+               SRL(w[t - 15], 3)); \
+      s1 = XOR(XOR(OR(SRL(w[t - 2], 17), SLL(w[t - 2], 15)), \
+                   OR(SRL(w[t - 2], 19), SLL(w[t - 2], 13))), \
+               SRL(w[t - 2], 10)); \
+      w[t] = ADD(ADD(w[t - 16], s0), ADD(w[t - 7], s1)); \
+    } \
+    for(t = 0; t < 64; t++) { \
+      s1 = XOR(XOR(OR(SRL(e, 6), SLL(e, 26)), OR(SRL(e, 11), SLL(e, 21))), \
+               OR(SRL(e, 25), SLL(e, 7))); \
+      t1 = ADD(ADD(ADD(h, s1), XOR(AND(e, f), ANDNOT(e, g))), \
+               ADD(SET1((int)k[t]), w[t])); \
+      s0 = XOR(XOR(OR(SRL(a, 2), SLL(a, 30)), OR(SRL(a, 13), SLL(a, 19))), \
+               OR(SRL(a, 22), SLL(a, 10))); \
+      t2 = ADD(s0, XOR(XOR(AND(a, b), AND(a, c)), AND(b, c))); \
+      h = g; g = f; f = e; e = ADD(d, t1); \
+      d = c; c = b; b = a; a = ADD(t1, t2); \
+    } \
+    st[0] = ADD(st[0], a); st[1] = ADD(st[1], b); \
+    st[2] = ADD(st[2], c); st[3] = ADD(st[3], d); \
+    st[4] = ADD(st[4], e); st[5] = ADD(st[5], f); \
+    st[6] = ADD(st[6], g); st[7] = ADD(st[7], h); \
+  } while(0)
+/*---------------------------------------------------------------------------*/
+__attribute__((target("avx2")))
+static void
+hash_lanes_avx2(struct lane *lanes, uint8_t digests[][SHA256_BLOCK_SIZE],
+                unsigned n)
+{
+  __m256i st[8], w[64];
+  uint32_t out[8][8];
+  const uint8_t *blk[8];
+  size_t b, maxb;
+  unsigned i;
+  int t;
+
+  maxb = 0;
+  for(i = 0; i < n; i++) {
+    if(lanes[i].nblocks > maxb) {
+      maxb = lanes[i].nblocks;
+    }
+  }
+  for(i = 0; i < 8; i++) {
+    st[i] = _mm256_set1_epi32((int)h0[i]);
+  }
+
+  for(b = 0; b < maxb; b++) {
+    for(i = 0; i < 8; i++) {
+      blk[i] = lane_block(&lanes[i < n ? i : 0], b);
+    }
+    for(t = 0; t < 16; t++) {
+      w[t] = _mm256_setr_epi32((int)load_be32(blk[0] + 4 * t), (int)load_be32(blk[1] + 4 * t),
+                               (int)load_be32(blk[2] + 4 * t), (int)load_be32(blk[3] + 4 * t),
+                               (int)load_be32(blk[4] + 4 * t), (int)load_be32(blk[5] + 4 * t),
+                               (int)load_be32(blk[6] + 4 * t), (int)load_be32(blk[7] + 4 * t));
+    }
+    SHA256_MB_ROUNDS(__m256i, _mm256_add_epi32, _mm256_xor_si256,
+                     _mm256_and_si256, _mm256_andnot_si256, _mm256_or_si256,
+                     _mm256_srli_epi32, _mm256_slli_epi32, _mm256_set1_epi32);
+
+    /* Collect lanes whose message ended with this block. */
+    for(i = 0; i < 8; i++) {
+      _mm256_storeu_si256((__m256i *)out[i], st[i]);
+    }
+    for(i = 0; i < n; i++) {
+      if(lanes[i].nblocks == b + 1) {
+        store_digest(digests[i], &out[0][i], 8);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+__attribute__((target("sse4.1")))
+static void
+hash_lanes_sse4(struct lane *lanes, uint8_t digests[][SHA256_BLOCK_SIZE],
+                unsigned n)
+{
+  __m128i st[8], w[64];
+  uint32_t out[8][4];
+  const uint8_t *blk[4];
+  size_t b, maxb;
+  unsigned i;
+  int t;
+
+  maxb = 0;
+  for(i = 0; i < n; i++) {
+    if(lanes[i].nblocks > maxb) {
+      maxb = lanes[i].nblocks;
+    }
+  }
+  for(i = 0; i < 8; i++) {
+    st[i] = _mm_set1_epi32((int)h0[i]);
+  }
+
+  for(b = 0; b < maxb; b++) {
+    for(i = 0; i < 4; i++) {
+      blk[i] = lane_block(&lanes[i < n ? i : 0], b);
+    }
+    for(t = 0; t < 16; t++) {
+      w[t] = _mm_setr_epi32((int)load_be32(blk[0] + 4 * t), (int)load_be32(blk[1] + 4 * t),
+                            (int)load_be32(blk[2] + 4 * t), (int)load_be32(blk[3] + 4 * t));
+    }
+    SHA256_MB_ROUNDS(__m128i, _mm_add_epi32, _mm_xor_si128,
+                     _mm_and_si128, _mm_andnot_si128, _mm_or_si128,
+                     _mm_srli_epi32, _mm_slli_epi32, _mm_set1_epi32);
+
+    for(i = 0; i < 8; i++) {
+      _mm_storeu_si128((__m128i *)out[i], st[i]);
+    }
+    for(i = 0; i < n; i++) {
+      if(lanes[i].nblocks == b + 1) {
+        store_digest(digests[i], &out[0][i], 4);
+      }
+    }
+  }
+}
+#endif /* SHA256_MB_X86 */
+/*---------------------------------------------------------------------------*/
+static void
+hash_scalar(const uint8_t *msg, size_t len, uint8_t digest[SHA256_BLOCK_SIZE])
+{
+  SHA256_CTX ctx;
+
+  sha256_init(&ctx);
+  sha256_update(&ctx, msg, len);
+  sha256_final(&ctx, digest);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+lane_count(void)
+{
+#if SHA256_MB_X86
+  static unsigned lanes;
+
+  if(lanes == 0) {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+      lanes = 8;
+    } else if(__builtin_cpu_supports("sse4.1")) {
+      lanes = 4;
+    } else {
+      lanes = 1;
+    }
+  }
+  return lanes;
+#else /* SHA256_MB_X86 */
+  return 1;
+#endif /* SHA256_MB_X86 */
+}
+/*---------------------------------------------------------------------------*/
+const char *
+sha256_mb_backend(void)
+{
+  switch(lane_count()) {
+  case 8:
+    return "avx2";
+  case 4:
+    return "sse4.1";
+  default:
+    return "scalar";
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sha256_mb(const uint8_t *const msgs[], const size_t lens[],
+          uint8_t digests[][SHA256_BLOCK_SIZE], unsigned n)
+{
+  unsigned width;
+  unsigned i;
+#if SHA256_MB_X86
+  struct lane lanes[SHA256_MB_MAX_LANES];
+  unsigned group, j;
+#endif /* SHA256_MB_X86 */
+
+  width = lane_count();
+  i = 0;
+#if SHA256_MB_X86
+  /* A single message gains nothing from the vector code. */
+  while(width > 1 && n - i > 1) {
+    group = n - i < width ? n - i : width;
+    for(j = 0; j < group; j++) {
+      lane_init(&lanes[j], msgs[i + j], lens[i + j]);
+    }
+    if(width == 8) {
+      hash_lanes_avx2(lanes, &digests[i], group);
+    } else {
+      hash_lanes_sse4(lanes, &digests[i], group);
+    }
+    i += group;
+  }
+#endif /* SHA256_MB_X86 */
+  for(; i < n; i++) {
+    hash_scalar(msgs[i], lens[i], digests[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sha256_mb_benchmark(void)
+{
+#if CONTIKI_TARGET_NATIVE
+#define BENCH_MSG_LEN  4096
+#define BENCH_ROUNDS   256
+#else
+#define BENCH_MSG_LEN  256
+#define BENCH_ROUNDS   4
+#endif
+  /* All lanes share one message to keep the buffer small on motes. */
+  static uint8_t msg[BENCH_MSG_LEN];
+  const uint8_t *msgs[SHA256_MB_MAX_LANES];
+  size_t lens[SHA256_MB_MAX_LANES];
+  uint8_t digests[SHA256_MB_MAX_LANES][SHA256_BLOCK_SIZE];
+  clock_time_t start, scalar_ticks, mb_ticks;
+  unsigned long bytes;
+  unsigned i, r;
+
+  memset(msg, 'A', BENCH_MSG_LEN);
+  for(i = 0; i < SHA256_MB_MAX_LANES; i++) {
+    msgs[i] = msg;
+    lens[i] = BENCH_MSG_LEN;
+  }
+  bytes = (unsigned long)BENCH_ROUNDS * SHA256_MB_MAX_LANES * BENCH_MSG_LEN;
+
+  start = clock_time();
+  for(r = 0; r < BENCH_ROUNDS; r++) {
+    for(i = 0; i < SHA256_MB_MAX_LANES; i++) {
+      hash_scalar(msgs[i], lens[i], digests[i]);
+    }
+  }
+  scalar_ticks = clock_time() - start;
+
+  start = clock_time();
+  for(r = 0; r < BENCH_ROUNDS; r++) {
+    sha256_mb(msgs, lens, digests, SHA256_MB_MAX_LANES);
+  }
+  mb_ticks = clock_time() - start;
+
+  /* MB/s; divide by 1000 for GB/s. */
+  printf("sha256 scalar [%lu] MB/s, multi-buffer [%s] [%lu] MB/s\n",
+         bytes / 1000 * CLOCK_SECOND / (scalar_ticks ? scalar_ticks : 1) / 1000,
+         sha256_mb_backend(),
+         bytes / 1000 * CLOCK_SECOND / (mb_ticks ? mb_ticks : 1) / 1000);
+}
+/*---------------------------------------------------------------------------*/
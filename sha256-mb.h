@@ -0,0 +1,55 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Multi-buffer SHA-256: hashes up to eight independent messages
+ *         at once, one message per SIMD lane (AVX2: 8 lanes, SSE4.1: 4
+ *         lanes). The lane width is picked at run time from CPUID; the
+ *         scalar sha256.c code is the fallback on every other CPU.
+ */
+
+#ifndef SHA256_MB_H_
+#define SHA256_MB_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sha256.h"
+
+#define SHA256_MB_MAX_LANES 8
+
+/* digests[i] = SHA-256(msgs[i], lens[i]) for i < n, any n. */
+void sha256_mb(const uint8_t *const msgs[], const size_t lens[],
+               uint8_t digests[][SHA256_BLOCK_SIZE], unsigned n);
+
+/* "avx2", "sse4.1" or "scalar". */
+const char *sha256_mb_backend(void);
+
+/* Prints scalar vs multi-buffer throughput. */
+void sha256_mb_benchmark(void);
+
+#endif /* SHA256_MB_H_ */
@@ -30,5 +30,6 @@ typedef struct {
 void sha256_init(SHA256_CTX *ctx);
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len);
 void sha256_final(SHA256_CTX *ctx, BYTE hash[]);
+void sha256_transform(SHA256_CTX *ctx, const BYTE data[]);  // one 64 byte block, for benchmarks
 
 #endif   // SHA256_H
\ No newline at end of file
@@ -0,0 +1,423 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Client swarm load generator for a native cert-service-provider
+ *         with the host front end enabled (make TARGET=native).
+ *
+ *         Emulated clients arrive as a Poisson process, each on its own
+ *         UDP socket, and run a full flight of MAX_CERT_FLIGHT sealed
+ *         fragments. A lost fragment or reply is retransmitted after a
+ *         timeout; a flight that runs out of retries counts as failed.
+ *         At the end, throughput and the handshake latency distribution
+ *         are printed.
+ *
+ *         Only the stand-in flight is spoken: 18 fragments of 128 bytes
+ *         of filler, as cert-service-client.c sends without CERT_CBOR.
+ *         A provider built with CERT_CBOR=1 rejects the filler as a
+ *         certificate, and with MERKLE_BATCH=1 it expects a batch proof,
+ *         so every flight would fail on a protocol mismatch rather than
+ *         on load. Built with either make variable, the tool refuses to
+ *         compile, and a run in which no flight completed says so.
+ *
+ *         Build: make cert-loadgen
+ *         Run:   ./cert-loadgen -r 500 -c 1000 -d 30 -l 1
+ */
+
+#include "aes-ccm.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#if CERT_CBOR_CONF_ENABLED || MERKLE_BATCH_CONF_ENABLED
+#error "cert-loadgen speaks the stand-in flight only, see the header"
+#endif
+
+/* Protocol constants, as in cert-service-client.c and cert-crypto.h. */
+#define MAX_CERT_FLIGHT   18
+#define CERT_FRAGMENT_LEN 128
+#define VIEW_MSG_LEN      44
+#define MSG_HDR_LEN       (2 + VIEW_MSG_LEN)
+#define CERT_FLIGHT_START 0x01
+#define CRYPTO_HDR_LEN    6
+#define FRAGMENT_LEN      (MSG_HDR_LEN + CRYPTO_HDR_LEN + CERT_FRAGMENT_LEN + AES_CCM_MIC_LEN)
+
+static const uint8_t fragment_key[AES_128_KEY_LEN] = {
+  0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+  0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+enum {
+  CLIENT_FREE,
+  CLIENT_THINK,    /* reply received, next fragment after think time */
+  CLIENT_WAIT      /* fragment sent, waiting for the reply */
+};
+
+struct client {
+  int fd;
+  uint8_t state;
+  uint8_t replies;
+  uint8_t retries;
+  uint16_t id;
+  uint32_t counter;
+  uint64_t start;
+  uint64_t deadline;
+};
+
+static struct aes_128_ctx ctx;
+static struct client *clients;
+static unsigned nclients;
+
+static double rate = 100;
+static unsigned concurrency = 1000;
+static unsigned duration = 10;
+static unsigned loss;
+static unsigned think_us;
+static unsigned timeout_ms = 500;
+static unsigned max_retries = 5;
+static struct sockaddr_in server;
+
+static uint64_t *latencies;
+static unsigned long completed, failed, blocked, fragments, retransmits, bad_mic;
+/* Flights begun; arrivals stop at rate * duration of these, which is
+   what latencies[] is sized for. */
+static unsigned long started;
+
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
+static int
+lost(void)
+{
+  return loss > 0 && (unsigned)(rand() % 100) < loss;
+}
+/*---------------------------------------------------------------------------*/
+static int
+open_socket(int epfd, unsigned index)
+{
+  struct epoll_event ev;
+  int fd;
+
+  fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if(fd < 0) {
+    perror("socket");
+    exit(1);
+  }
+  /* connect() fixes the peer so replies are matched by the kernel. */
+  if(connect(fd, (struct sockaddr *)&server, sizeof(server)) < 0) {
+    perror("connect");
+    exit(1);
+  }
+  ev.events = EPOLLIN;
+  ev.data.u32 = index;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+  return fd;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_fragment(struct client *c)
+{
+  uint8_t msg[FRAGMENT_LEN];
+  uint8_t nonce[AES_CCM_NONCE_LEN];
+  uint8_t *p;
+
+  memset(msg, 0, MSG_HDR_LEN);
+  msg[0] = c->replies + 1;
+  msg[1] = c->replies == 0 ? CERT_FLIGHT_START : 0;
+  p = msg + MSG_HDR_LEN;
+  /* Every transmission, retransmissions included, is sealed afresh, or
+     the provider's replay window drops it (see replay-window.h). */
+  c->counter++;
+  p[0] = c->id >> 8;
+  p[1] = c->id & 0xff;
+  p[2] = c->counter >> 24;
+  p[3] = c->counter >> 16;
+  p[4] = c->counter >> 8;
+  p[5] = c->counter;
+  memset(p + CRYPTO_HDR_LEN, 'A', CERT_FRAGMENT_LEN);
+  p[CRYPTO_HDR_LEN + CERT_FRAGMENT_LEN - 1] = 0;
+  memset(nonce, 0, sizeof(nonce));
+  memcpy(nonce, p, CRYPTO_HDR_LEN);
+  aes_ccm_encrypt(&ctx, nonce, NULL, 0, p + CRYPTO_HDR_LEN, CERT_FRAGMENT_LEN,
+                  p + CRYPTO_HDR_LEN + CERT_FRAGMENT_LEN);
+
+  if(!lost()) {
+    send(c->fd, msg, sizeof(msg), 0);
+  }
+  fragments++;
+  c->state = CLIENT_WAIT;
+  c->deadline = now_us() + (uint64_t)timeout_ms * 1000;
+}
+/*---------------------------------------------------------------------------*/
+static void
+finish(struct client *c, int epfd, int ok)
+{
+  if(ok) {
+    latencies[completed++] = now_us() - c->start;
+  } else {
+    failed++;
+    /* The provider may still hold a session for this port; use a new one. */
+    close(c->fd);
+    c->fd = open_socket(epfd, c - clients);
+  }
+  c->state = CLIENT_FREE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+receive(struct client *c, int epfd)
+{
+  uint8_t buf[512];
+  uint8_t nonce[AES_CCM_NONCE_LEN];
+  uint8_t *p;
+  ssize_t n;
+  int len;
+
+  while((n = recv(c->fd, buf, sizeof(buf), 0)) > 0) {
+    if(c->state != CLIENT_WAIT || lost()) {
+      continue;
+    }
+    len = n - MSG_HDR_LEN - CRYPTO_HDR_LEN - AES_CCM_MIC_LEN;
+    p = buf + MSG_HDR_LEN;
+    if(len < 0) {
+      bad_mic++;
+      continue;
+    }
+    memset(nonce, 0, sizeof(nonce));
+    memcpy(nonce, p, CRYPTO_HDR_LEN);
+    if(!aes_ccm_decrypt(&ctx, nonce, NULL, 0, p + CRYPTO_HDR_LEN, len,
+                        p + CRYPTO_HDR_LEN + len)) {
+      bad_mic++;
+      continue;
+    }
+    c->replies++;
+    c->retries = 0;
+    if(c->replies == MAX_CERT_FLIGHT) {
+      finish(c, epfd, 1);
+    } else if(think_us > 0) {
+      c->state = CLIENT_THINK;
+      c->deadline = now_us() + think_us;
+    } else {
+      send_fragment(c);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+arrive(void)
+{
+  static unsigned next;
+  struct client *c;
+  unsigned i;
+
+  for(i = 0; i < nclients; i++) {
+    c = &clients[(next + i) % nclients];
+    if(c->state == CLIENT_FREE) {
+      next = (next + i + 1) % nclients;
+      c->replies = 0;
+      c->retries = 0;
+      c->start = now_us();
+      started++;
+      send_fragment(c);
+      return;
+    }
+  }
+  blocked++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+expire(int epfd, uint64_t now)
+{
+  struct client *c;
+  unsigned i;
+
+  for(i = 0; i < nclients; i++) {
+    c = &clients[i];
+    if(c->state == CLIENT_FREE || now < c->deadline) {
+      continue;
+    }
+    if(c->state == CLIENT_THINK) {
+      send_fragment(c);
+    } else if(c->retries++ < max_retries) {
+      retransmits++;
+      send_fragment(c);
+    } else {
+      finish(c, epfd, 0);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+cmp_u64(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+/*---------------------------------------------------------------------------*/
+static double
+percentile(double p)
+{
+  unsigned long i;
+
+  if(completed == 0) {
+    return 0;
+  }
+  i = (unsigned long)ceil(p * completed) - 1;
+  return latencies[i < completed ? i : completed - 1] / 1000.0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [-s host] [-p port] [-r arrivals/s] [-c clients]\n"
+          "          [-d seconds] [-l loss%%] [-t think us] [-T timeout ms]\n"
+          "          [-R retries] [-S seed]\n", name);
+  exit(2);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  struct epoll_event events[256];
+  const char *host = "127.0.0.1";
+  unsigned port = 5688;
+  unsigned seed = 1;
+  uint64_t start, end, now, next_arrival, wait;
+  double elapsed;
+  int epfd, n, i, opt;
+
+  while((opt = getopt(argc, argv, "s:p:r:c:d:l:t:T:R:S:h")) != -1) {
+    switch(opt) {
+    case 's': host = optarg; break;
+    case 'p': port = atoi(optarg); break;
+    case 'r': rate = atof(optarg); break;
+    case 'c': concurrency = atoi(optarg); break;
+    case 'd': duration = atoi(optarg); break;
+    case 'l': loss = atoi(optarg); break;
+    case 't': think_us = atoi(optarg); break;
+    case 'T': timeout_ms = atoi(optarg); break;
+    case 'R': max_retries = atoi(optarg); break;
+    case 'S': seed = atoi(optarg); break;
+    default: usage(argv[0]);
+    }
+  }
+  if(rate <= 0 || concurrency == 0 || concurrency > 65535) {
+    usage(argv[0]);
+  }
+  srand(seed);
+  aes_128_set_key(&ctx, fragment_key);
+
+  memset(&server, 0, sizeof(server));
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  if(inet_pton(AF_INET, host, &server.sin_addr) != 1) {
+    fprintf(stderr, "bad address %s\n", host);
+    return 2;
+  }
+
+  epfd = epoll_create1(0);
+  nclients = concurrency;
+  clients = calloc(nclients, sizeof(*clients));
+  latencies = malloc(sizeof(*latencies) * ((size_t)(rate * duration) + 1));
+  if(clients == NULL || latencies == NULL) {
+    perror("malloc");
+    return 1;
+  }
+  for(i = 0; i < (int)nclients; i++) {
+    /* Above the mesh node ids, which share the provider's replay table. */
+    clients[i].id = 0x8000 + i;
+    /* Counters must grow across runs against the same provider; this
+       holds below 1024 fragments per second and client. */
+    clients[i].counter = (uint32_t)time(NULL) << 10;
+    clients[i].fd = open_socket(epfd, i);
+  }
+
+  start = now_us();
+  end = start + (uint64_t)duration * 1000000;
+  next_arrival = start;
+  printf("loadgen: %s:%u, %.0f arrivals/s, %u clients, %u s, %u%% loss\n",
+         host, port, rate, concurrency, duration, loss);
+
+  while((now = now_us()) < end) {
+    while(next_arrival <= now && started + blocked <
+          (unsigned long)(rate * duration)) {
+      arrive();
+      /* Exponential inter-arrival times. */
+      next_arrival += (uint64_t)(-log(1.0 - rand() / (RAND_MAX + 1.0)) * 1e6 / rate);
+    }
+    expire(epfd, now);
+
+    wait = next_arrival > now ? next_arrival - now : 0;
+    n = epoll_wait(epfd, events, 256, wait > 1000 ? 1 : 0);
+    if(n < 0 && errno != EINTR) {
+      perror("epoll_wait");
+      return 1;
+    }
+    for(i = 0; i < n; i++) {
+      receive(&clients[events[i].data.u32], epfd);
+    }
+  }
+  elapsed = (now_us() - start) / 1e6;
+
+  qsort(latencies, completed, sizeof(*latencies), cmp_u64);
+  for(i = 0, n = 0; i < (int)nclients; i++) {
+    n += clients[i].state != CLIENT_FREE;
+  }
+  printf("completed %lu, failed %lu, blocked %lu, in flight %d\n",
+         completed, failed, blocked, n);
+  if(completed == 0 && failed > 0) {
+    fprintf(stderr, "no flight completed: is the provider built with "
+            "CERT_CBOR=1 or MERKLE_BATCH=1? Those flights are not "
+            "supported.\n");
+  }
+  printf("fragments %lu, retransmits %lu, bad MIC %lu\n",
+         fragments, retransmits, bad_mic);
+  printf("throughput %.1f handshakes/s\n", completed / elapsed);
+  printf("latency ms: p50 %.2f p99 %.2f p999 %.2f max %.2f\n",
+         percentile(0.50), percentile(0.99), percentile(0.999),
+         percentile(1.0));
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""Decode the binary packet log of collect-log.c back into text.
+
+Reads the raw serial stream of a node built with BINLOG=1 and prints the
+same lines collect_common_recv() prints in text mode, so the output can
+be fed to collect-view or the existing log scripts. Bytes that are not
+part of a valid record (ordinary printf output) are passed through.
+
+Usage: collect-log-decode.py [serial-dump]   (default: stdin)
+"""
+
+import struct
+import sys
+
+SYNC = 0xA5
+TYPE_PACKET = 0x01
+
+# struct collect_view_data_msg: len, clock, timesynch_time, cpu, lpm,
+# transmit, listen, ... all uint16_t, little endian on sky and native.
+VIEW_FIELDS = ("len", "clock", "timesynch_time", "cpu", "lpm",
+               "transmit", "listen")
+
+
+def packet_lines(body):
+    time, originator, seqno, hops = struct.unpack_from("<IHBB", body)
+    payload = body[8:]
+    words = struct.unpack_from("<%dH" % (len(payload) // 2), payload)
+    lines = []
+    if len(words) >= len(VIEW_FIELDS):
+        msg = dict(zip(VIEW_FIELDS, words))
+        lines.append("originator [%u], squence no [%u], clock [%u], "
+                     "timesync_time [%u], cpu_power [%u], lpm_power [%u], "
+                     "transmit_power [%u], listen_power [%u] "
+                     % (originator, seqno, msg["clock"],
+                        msg["timesynch_time"], msg["cpu"], msg["lpm"],
+                        msg["transmit"], msg["listen"]))
+    fields = [8 + len(payload) // 2, (time >> 16) & 0xffff, time & 0xffff, 0,
+              originator, seqno, hops, 0]
+    fields.extend(words)
+    lines.append(" ".join(str(f) for f in fields))
+    return lines
+
+
+def decode(data, out):
+    i = 0
+    text = bytearray()
+    while i < len(data):
+        if data[i] == SYNC and i + 3 <= len(data):
+            rtype, length = data[i + 1], data[i + 2]
+            end = i + 3 + length
+            if end < len(data):
+                body = data[i + 3:end]
+                check = rtype ^ length
+                for b in body:
+                    check ^= b
+                if check == data[end] and rtype == TYPE_PACKET and length >= 8:
+                    out.write(text.decode("latin-1"))
+                    text.clear()
+                    for line in packet_lines(bytes(body)):
+                        out.write(line + "\n")
+                    i = end + 1
+                    continue
+        text.append(data[i])
+        i += 1
+    out.write(text.decode("latin-1"))
+
+
+def main():
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    decode(data, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,100 @@
+/*
+ * Cooja test script for the headless benchmark suite.
+ *
+ * Waits until @SESSIONS@ certificate flights have completed across all
+ * client motes and logs one BENCH line per flight:
+ *
+ *   BENCH,<mote id>,<sim time ms>,<handshake latency ms>,<energy mJ>,
+ *         <flight bytes>,<provider hops>,<busy replies>,<listen ms>,
+ *         <transmit ms>
+ *
+ * The latency comes from the client's "celasped_time" line (clock
+ * ticks, CLOCK_SECOND = 128 on sky), the energy from the
+ * "energy consumption" line that follows it and the UDP payload bytes
+ * sent plus received from the "flight bytes" line before both. The hop
+ * count to the provider that served the flight comes from the
+ * "flight provider" line, and how often admission control turned the
+ * flight away before it started from the "admit: in after" line. Radio
+ * listen and transmit time over the same window as the energy come from
+ * the "radio" line, to weigh per-fragment strobing against keeping the
+ * radio on for the flight (RDC_BURST=1).
+ *
+ * At the end one line with the provider's cumulative UDP payload bytes,
+ * flight traffic each way and certificate cache traffic, from its last
+ * "root bytes" line:
+ *
+ *   BENCH_ROOT,<tx>,<rx>,<cache>
+ *
+ * and the sim time by which every mote that ran a flight had finished
+ * its first one, the time to authenticate the whole network after a
+ * reboot storm:
+ *
+ *   BENCH_ALL,<motes>,<sim time ms>
+ */
+TIMEOUT(@TIMEOUT_MS@, log.log("BENCH_TIMEOUT," + sessions + "\n"); log.testFailed());
+
+var sessions = 0;
+var latency = {};
+var bytes = {};
+var hops = {};
+var busy = {};
+var radio = {};
+var first = {};
+var motes = 0;
+var all = 0;
+var root = null;
+
+while(sessions < @SESSIONS@) {
+  YIELD();
+  var m = msg.match(/root bytes \[(\d+)\] tx \[(\d+)\] rx \[(\d+)\] cache/);
+  if(m) {
+    root = m[1] + "," + m[2] + "," + m[3];
+    continue;
+  }
+  m = msg.match(/flight bytes \[(\d+)\] tx \[(\d+)\] rx/);
+  if(m) {
+    bytes[id] = parseInt(m[1]) + parseInt(m[2]);
+    continue;
+  }
+  m = msg.match(/flight provider \[\d+\] hops \[(\d+)\]/);
+  if(m) {
+    hops[id] = parseInt(m[1]);
+    continue;
+  }
+  m = msg.match(/admit: in after \[(\d+)\] busy/);
+  if(m) {
+    busy[id] = parseInt(m[1]);
+    continue;
+  }
+  m = msg.match(/celasped_time \[(\d+)\] ticks/);
+  if(m) {
+    latency[id] = Math.round(parseInt(m[1]) * 1000 / 128);
+    continue;
+  }
+  m = msg.match(/radio \[(\d+)\] ms listen \[(\d+)\] ms transmit/);
+  if(m) {
+    radio[id] = m[1] + "," + m[2];
+    continue;
+  }
+  m = msg.match(/energy consumption \[(\d+)\] mJ/);
+  if(m) {
+    sessions++;
+    if(first[id] === undefined) {
+      first[id] = true;
+      motes++;
+      all = Math.round(time / 1000);
+    }
+    log.log("BENCH," + id + "," + Math.round(time / 1000) + "," +
+            (latency[id] === undefined ? "" : latency[id]) + "," + m[1] + "," +
+            (bytes[id] === undefined ? "" : bytes[id]) + "," +
+            (hops[id] === undefined ? "" : hops[id]) + "," +
+            (busy[id] === undefined ? 0 : busy[id]) + "," +
+            (radio[id] === undefined ? "," : radio[id]) + "\n");
+    busy[id] = 0;
+  }
+}
+if(root !== null) {
+  log.log("BENCH_ROOT," + root + "\n");
+}
+log.log("BENCH_ALL," + motes + "," + all + "\n");
+log.testOK();
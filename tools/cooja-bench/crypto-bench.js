@@ -0,0 +1,15 @@
+/*
+ * Cooja test script for make crypto-bench: copies the mote's
+ * crypto-bench lines to the test log and stops at crypto-bench,done.
+ */
+TIMEOUT(3600000, log.log("crypto-bench,timeout\n"); log.testFailed());
+
+while(true) {
+  YIELD();
+  if(msg.indexOf("crypto-bench,") == 0) {
+    log.log(msg + "\n");
+    if(msg.indexOf("crypto-bench,done") == 0) {
+      log.testOK();
+    }
+  }
+}
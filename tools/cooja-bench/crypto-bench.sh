@@ -0,0 +1,81 @@
+#!/bin/sh
+#
+# Builds and runs the crypto microbenchmarks (make crypto-bench) and
+# writes the results as CSV.
+#
+#   crypto-bench.sh native [out.csv]   run crypto-bench.native directly
+#   crypto-bench.sh sky [out.csv]      run crypto-bench.sky headless in Cooja
+#
+# Extra make variables (CRYPTO_BENCH_ITERATIONS, CPU_HZ, AES_COMPACT...)
+# are taken from the environment.
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+APP=$(cd "$HERE/../.." && pwd)
+CONTIKI=${CONTIKI:-$APP/../../..}
+TARGET=${1:-native}
+OUT=${2:-$HERE/crypto-bench-$TARGET.csv}
+
+collect() {
+  grep '^crypto-bench,' | grep -v '^crypto-bench,done' |
+    sed 's/^crypto-bench,//' > "$OUT"
+  echo "results in $OUT"
+}
+
+cd "$APP"
+# Objects built with other make variables would be reused as they are.
+make TARGET=$TARGET clean > /dev/null
+case $TARGET in
+native)
+  make TARGET=native crypto-bench
+  ./crypto-bench.native | collect
+  ;;
+sky)
+  make TARGET=sky crypto-bench.sky
+  python3 - "$APP/collect-cert-noloss.csc" "$HERE/crypto-bench.js" \
+    "$APP/.crypto-bench.csc" <<'PY'
+import sys
+import xml.etree.ElementTree as ET
+
+base, script, out = sys.argv[1:]
+tree = ET.parse(base)
+root = tree.getroot()
+sim = root.find("simulation")
+for mt in sim.findall("motetype"):
+    if mt.find("identifier").text != "cert-client":
+        sim.remove(mt)
+        continue
+    mt.find("identifier").text = "crypto-bench"
+    mt.find("description").text = "Sky Mote Type #crypto-bench"
+    mt.find("source").text = "[CONFIG_DIR]/crypto-bench.c"
+    mt.find("commands").text = "make crypto-bench.sky TARGET=sky"
+    mt.find("firmware").text = "[CONFIG_DIR]/crypto-bench.sky"
+motes = sim.findall("mote")
+for m in motes:
+    sim.remove(m)
+mote = [m for m in motes if m.find("motetype_identifier").text == "cert-client"][0]
+mote.find("motetype_identifier").text = "crypto-bench"
+sim.append(mote)
+for plugin in root.findall("plugin"):
+    root.remove(plugin)
+plugin = ET.SubElement(root, "plugin")
+plugin.text = "org.contikios.cooja.plugins.ScriptRunner"
+conf = ET.SubElement(plugin, "plugin_config")
+ET.SubElement(conf, "script").text = open(script).read()
+ET.SubElement(conf, "active").text = "true"
+for tag, value in (("width", 600), ("z", 0), ("height", 700),
+                   ("location_x", 0), ("location_y", 0)):
+    ET.SubElement(plugin, tag).text = str(value)
+tree.write(out, encoding="UTF-8", xml_declaration=True)
+PY
+  java -mx512m -jar "$CONTIKI/tools/cooja/dist/cooja.jar" \
+    -nogui=.crypto-bench.csc -contiki="$CONTIKI" > /dev/null 2>&1 || true
+  rm -f .crypto-bench.csc
+  collect < COOJA.testlog
+  ;;
+*)
+  echo "usage: $0 native|sky [out.csv]" >&2
+  exit 2
+  ;;
+esac
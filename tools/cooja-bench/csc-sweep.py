@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Derive a headless benchmark simulation from one of the .csc files.
+
+Sets the UDGM radio parameters, the random seed and PERIOD, replaces
+the client motes with --nodes clients on a ring around the provider,
+drops the GUI plugins and adds a ScriptRunner running bench.js.
+
+Contiki's make does not rebuild objects when only make variables
+change, so run "make clean TARGET=sky" before each simulation that
+differs in PERIOD or --make-args; run-bench.sh does.
+"""
+
+import argparse
+import math
+import os
+import xml.etree.ElementTree as ET
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def set_text(parent, tag, value):
+    parent.find(tag).text = str(value)
+
+
+def client_mote(template, mote_id, x, y):
+    mote = ET.fromstring(ET.tostring(template))
+    for conf in mote.findall("interface_config"):
+        name = conf.text.strip()
+        if name.endswith("interfaces.Position"):
+            set_text(conf, "x", x)
+            set_text(conf, "y", y)
+        elif name.endswith("MspMoteID"):
+            set_text(conf, "id", mote_id)
+    return mote
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__)
+    ap.add_argument("--base", default=os.path.join(HERE, "..", "..",
+                                                   "collect-cert-lossy.csc"))
+    ap.add_argument("--range", type=float, default=70.0,
+                    help="transmitting range; interference is range + 20")
+    ap.add_argument("--rx", type=float, default=1.0, help="success_ratio_rx")
+    ap.add_argument("--nodes", type=int, default=1, help="client motes")
+    ap.add_argument("--period", type=int, default=60)
+    ap.add_argument("--sessions", type=int, default=10)
+    ap.add_argument("--timeout-ms", type=int, default=3600000,
+                    help="simulated time limit")
+    ap.add_argument("--seed", type=int, default=123456)
+    ap.add_argument("--make-args", default="",
+                    help="extra make variables, e.g. CERT_CBOR=1")
+    ap.add_argument("-o", "--output", required=True)
+    args = ap.parse_args()
+
+    tree = ET.parse(args.base)
+    root = tree.getroot()
+    sim = root.find("simulation")
+    set_text(sim, "randomseed", args.seed)
+    radio = sim.find("radiomedium")
+    set_text(radio, "transmitting_range", args.range)
+    set_text(radio, "interference_range", args.range + 20)
+    set_text(radio, "success_ratio_rx", args.rx)
+
+    # Firmware is built with the requested PERIOD and make variables
+    # (see Makefile), from a clean tree (see above).
+    for motetype in sim.findall("motetype"):
+        cmd = motetype.find("commands")
+        cmd.text = "%s PERIOD=%d" % (cmd.text.split(" PERIOD=")[0], args.period)
+        if args.make_args:
+            cmd.text += " " + args.make_args
+
+    motes = sim.findall("mote")
+    provider = [m for m in motes
+                if m.find("motetype_identifier").text == "cert-provider"][0]
+    client = [m for m in motes
+              if m.find("motetype_identifier").text == "cert-client"][0]
+    for m in motes:
+        if m is not provider:
+            sim.remove(m)
+
+    pos = [c for c in provider.findall("interface_config")
+           if c.text.strip().endswith("interfaces.Position")][0]
+    px, py = float(pos.find("x").text), float(pos.find("y").text)
+    # One hop: every client sits well inside the provider's range.
+    radius = args.range * 0.6
+    for i in range(args.nodes):
+        a = 2 * math.pi * i / args.nodes
+        sim.append(client_mote(client, i + 2, px + radius * math.cos(a),
+                               py + radius * math.sin(a)))
+
+    # Visualizers and collect-view need a display; keep the run headless.
+    for plugin in root.findall("plugin"):
+        root.remove(plugin)
+    with open(os.path.join(HERE, "bench.js")) as f:
+        script = (f.read().replace("@SESSIONS@", str(args.sessions))
+                  .replace("@TIMEOUT_MS@", str(args.timeout_ms)))
+    plugin = ET.SubElement(root, "plugin")
+    plugin.text = "org.contikios.cooja.plugins.ScriptRunner"
+    conf = ET.SubElement(plugin, "plugin_config")
+    ET.SubElement(conf, "script").text = script
+    ET.SubElement(conf, "active").text = "true"
+    for tag, value in (("width", 600), ("z", 0), ("height", 700),
+                       ("location_x", 0), ("location_y", 0)):
+        ET.SubElement(plugin, tag).text = str(value)
+
+    tree.write(args.output, encoding="UTF-8", xml_declaration=True)
+
+
+if __name__ == "__main__":
+    main()
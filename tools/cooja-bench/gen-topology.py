@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""Generate large cert client/provider scenarios for Cooja.
+
+The mote types (firmware, interfaces) are taken from a base .csc; the
+generator only places motes. Providers get ids 1..P and clients the
+ids after them. By default all providers root the aaaa::/64 DODAG as
+aaaa::1, so each client talks to the provider whose tree it joined.
+Built with PROVIDER_SELECT=1 provider 1 is the only root, the others
+register with it and each client picks the provider with the fewest
+hops (see provider-select.h); the hops column of the benchmark CSV
+gives the average.
+
+--trickle attaches trickle.js instead of bench.js, for firmware built
+with CERT_TRICKLE=1 and a single provider: it waits until every client
+holds the provider certificate and logs the completion time and the
+transmissions of all nodes, to compare densities and node counts.
+
+Layouts:
+  grid       clients on a square grid, providers spread over it
+  random     clients uniform over a square of the same density
+  clustered  clients gaussian around one cluster per provider
+
+Examples:
+  gen-topology.py --nodes 250 --layout grid -o grid-250.csc
+  gen-topology.py --nodes 500 --providers 4 --layout clustered \\
+                  --rx 0.8 --seed 7 --sessions 500 -o c500.csc
+  gen-topology.py --nodes 200 --spacing 20 --trickle -o dense-200.csc
+"""
+
+import argparse
+import math
+import os
+import random
+import xml.etree.ElementTree as ET
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def set_text(parent, tag, value):
+    parent.find(tag).text = str(value)
+
+
+def make_mote(template, mote_id, x, y):
+    mote = ET.fromstring(ET.tostring(template))
+    for conf in mote.findall("interface_config"):
+        name = conf.text.strip()
+        if name.endswith("interfaces.Position"):
+            set_text(conf, "x", "%.2f" % x)
+            set_text(conf, "y", "%.2f" % y)
+        elif name.endswith("MspMoteID"):
+            set_text(conf, "id", mote_id)
+    return mote
+
+
+def grid(n, spacing):
+    side = int(math.ceil(math.sqrt(n)))
+    return [((i % side) * spacing, (i // side) * spacing) for i in range(n)]
+
+
+def layout_grid(rng, args):
+    clients = grid(args.nodes, args.spacing)
+    # Providers on a coarse grid over the same area, centred in their cell.
+    size = int(math.ceil(math.sqrt(args.nodes))) * args.spacing
+    side = int(math.ceil(math.sqrt(args.providers)))
+    cell = size / side
+    providers = [((i % side + 0.5) * cell, (i // side + 0.5) * cell)
+                 for i in range(args.providers)]
+    return providers, clients
+
+
+def layout_random(rng, args):
+    size = math.sqrt(args.nodes) * args.spacing
+    point = lambda: (rng.uniform(0, size), rng.uniform(0, size))
+    return ([point() for _ in range(args.providers)],
+            [point() for _ in range(args.nodes)])
+
+
+def layout_clustered(rng, args):
+    size = math.sqrt(args.nodes) * args.spacing
+    centers = [(rng.uniform(0, size), rng.uniform(0, size))
+               for _ in range(args.providers)]
+    sigma = args.spread * args.spacing * math.sqrt(args.nodes / args.providers)
+    clients = []
+    for i in range(args.nodes):
+        cx, cy = centers[i % args.providers]
+        clients.append((rng.gauss(cx, sigma), rng.gauss(cy, sigma)))
+    return centers, clients
+
+
+LAYOUTS = {
+    "grid": layout_grid,
+    "random": layout_random,
+    "clustered": layout_clustered,
+}
+
+
+def main():
+    ap = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--base", default=os.path.join(HERE, "..", "..",
+                                                   "collect-cert-lossy.csc"))
+    ap.add_argument("--layout", choices=sorted(LAYOUTS), default="grid")
+    ap.add_argument("--nodes", type=int, default=100, help="client motes")
+    ap.add_argument("--providers", type=int, default=1)
+    ap.add_argument("--range", type=float, default=50.0,
+                    help="transmitting range; interference is range + 20")
+    ap.add_argument("--spacing", type=float, default=None,
+                    help="mean client spacing (default 0.7 * range)")
+    ap.add_argument("--spread", type=float, default=0.25,
+                    help="cluster sigma relative to the cluster radius")
+    ap.add_argument("--tx", type=float, default=1.0, help="success_ratio_tx")
+    ap.add_argument("--rx", type=float, default=1.0, help="success_ratio_rx")
+    ap.add_argument("--seed", type=int, default=123456,
+                    help="layout and simulation seed")
+    ap.add_argument("--sessions", type=int, default=0,
+                    help="attach bench.js waiting for this many flights")
+    ap.add_argument("--trickle", action="store_true",
+                    help="attach trickle.js waiting for every client")
+    ap.add_argument("--timeout-ms", type=int, default=7200000)
+    ap.add_argument("--gui", action="store_true",
+                    help="keep the visualizer plugins of the base file")
+    ap.add_argument("-o", "--output", required=True)
+    args = ap.parse_args()
+    if args.spacing is None:
+        args.spacing = 0.7 * args.range
+    if args.providers < 1 or args.nodes < 1:
+        ap.error("need at least one provider and one client")
+    if args.trickle and (args.providers != 1 or args.sessions):
+        ap.error("--trickle needs a single provider and no --sessions")
+
+    rng = random.Random(args.seed)
+    providers, clients = LAYOUTS[args.layout](rng, args)
+
+    tree = ET.parse(args.base)
+    root = tree.getroot()
+    sim = root.find("simulation")
+    set_text(sim, "title", "cert %s %d+%d seed %d" %
+             (args.layout, args.providers, args.nodes, args.seed))
+    set_text(sim, "randomseed", args.seed)
+    radio = sim.find("radiomedium")
+    set_text(radio, "transmitting_range", args.range)
+    set_text(radio, "interference_range", args.range + 20)
+    set_text(radio, "success_ratio_tx", args.tx)
+    set_text(radio, "success_ratio_rx", args.rx)
+
+    templates = {}
+    for m in sim.findall("mote"):
+        templates.setdefault(m.find("motetype_identifier").text, m)
+        sim.remove(m)
+
+    mote_id = 1
+    for kind, points in (("cert-provider", providers), ("cert-client", clients)):
+        for x, y in points:
+            sim.append(make_mote(templates[kind], mote_id, x, y))
+            mote_id += 1
+
+    if not args.gui:
+        for plugin in root.findall("plugin"):
+            root.remove(plugin)
+    script = None
+    if args.sessions:
+        with open(os.path.join(HERE, "bench.js")) as f:
+            script = (f.read().replace("@SESSIONS@", str(args.sessions))
+                      .replace("@TIMEOUT_MS@", str(args.timeout_ms)))
+    elif args.trickle:
+        with open(os.path.join(HERE, "trickle.js")) as f:
+            script = (f.read().replace("@NODES@", str(len(clients)))
+                      .replace("@TIMEOUT_MS@", str(args.timeout_ms)))
+    if script is not None:
+        plugin = ET.SubElement(root, "plugin")
+        plugin.text = "org.contikios.cooja.plugins.ScriptRunner"
+        conf = ET.SubElement(plugin, "plugin_config")
+        ET.SubElement(conf, "script").text = script
+        ET.SubElement(conf, "active").text = "true"
+        for tag, value in (("width", 600), ("z", 0), ("height", 700),
+                           ("location_x", 0), ("location_y", 0)):
+            ET.SubElement(plugin, tag).text = str(value)
+
+    tree.write(args.output, encoding="UTF-8", xml_declaration=True)
+    print("%s: %d providers, %d clients, %s layout" %
+          (args.output, len(providers), len(clients), args.layout))
+
+
+if __name__ == "__main__":
+    main()
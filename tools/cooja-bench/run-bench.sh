@@ -0,0 +1,94 @@
+#!/bin/sh
+#
+# Headless Cooja benchmark sweep for the certificate service.
+#
+# For every combination of radio range, success_ratio_rx, client count
+# and PERIOD a simulation is generated with csc-sweep.py, run with
+# cooja -nogui until $SESSIONS flights completed, and the per-flight
+# handshake latency, energy and flight bytes are appended to $OUT as CSV.
+# The provider's total link traffic per run goes to $OUT_ROOT, the time
+# until every client finished its first flight to $OUT_ALL.
+#
+# Every knob is an environment variable, for example:
+#   RANGES="50 70" RX_RATIOS="1.0 0.8" NODES="1 4 8" ./run-bench.sh
+# MAKE_ARGS is passed to the firmware build, e.g. compare the X.509
+# stand-in flight with the compact one:
+#   MAKE_ARGS="CERT_CBOR=0" OUT=x509.csv ./run-bench.sh
+#   MAKE_ARGS="CERT_CBOR=1" OUT=cbor.csv ./run-bench.sh
+# or root link traffic with and without the router certificate cache:
+#   MAKE_ARGS="CERT_CBOR=1 CERT_CACHE=1" OUT=cache.csv ./run-bench.sh
+# or a reboot storm, every client starting within PERIOD seconds, with and
+# without provider admission control:
+#   NODES=30 SESSIONS=30 PERIODS=5 MAKE_ARGS="CERT_ADMIT=0" OUT=storm.csv ./run-bench.sh
+#   NODES=30 SESSIONS=30 PERIODS=5 MAKE_ARGS="CERT_ADMIT=1" OUT=admit.csv ./run-bench.sh
+# or client energy with ContikiMAC strobing every fragment against the
+# radio kept on for the flight, in both scenarios:
+#   MAKE_ARGS="RDC_BURST=0" OUT=strobe-lossy.csv ./run-bench.sh
+#   MAKE_ARGS="RDC_BURST=1" OUT=burst-lossy.csv ./run-bench.sh
+#   BASE=../../collect-cert-noloss.csc MAKE_ARGS="RDC_BURST=0" OUT=strobe-noloss.csv ./run-bench.sh
+#   BASE=../../collect-cert-noloss.csc MAKE_ARGS="RDC_BURST=1" OUT=burst-noloss.csv ./run-bench.sh
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+CONTIKI=${CONTIKI:-$HERE/../../../../..}
+BASE=${BASE:-$HERE/../../collect-cert-lossy.csc}
+RANGES=${RANGES:-"50 70 100"}
+RX_RATIOS=${RX_RATIOS:-"1.0 0.9 0.7"}
+NODES=${NODES:-"1 4 8"}
+PERIODS=${PERIODS:-"60"}
+SESSIONS=${SESSIONS:-10}
+SEED=${SEED:-123456}
+OUT=${OUT:-$HERE/bench-$(date +%Y%m%d-%H%M%S).csv}
+WORK=${WORK:-$HERE/build}
+MAKE_ARGS=${MAKE_ARGS:-}
+OUT_ROOT=${OUT_ROOT:-${OUT%.csv}-root.csv}
+OUT_ALL=${OUT_ALL:-${OUT%.csv}-all.csv}
+
+COOJA_JAR=$CONTIKI/tools/cooja/dist/cooja.jar
+if [ ! -f "$COOJA_JAR" ]; then
+  echo "cooja.jar not found, build it with 'ant jar' in $CONTIKI/tools/cooja" >&2
+  exit 1
+fi
+
+mkdir -p "$WORK"
+echo "range,rx_ratio,nodes,period,seed,mote,sim_time_ms,latency_ms,energy_mj,flight_bytes,hops,busy,listen_ms,tx_ms" > "$OUT"
+echo "range,rx_ratio,nodes,period,seed,root_tx_bytes,root_rx_bytes,root_cache_bytes" > "$OUT_ROOT"
+echo "range,rx_ratio,nodes,period,seed,motes,all_done_ms" > "$OUT_ALL"
+
+for period in $PERIODS; do
+  for range in $RANGES; do
+    for rx in $RX_RATIOS; do
+      for nodes in $NODES; do
+        run=r${range}-rx${rx}-n${nodes}-p${period}
+        echo "== $run"
+        python3 "$HERE/csc-sweep.py" --base "$BASE" --range "$range" \
+          --rx "$rx" --nodes "$nodes" --period "$period" \
+          --sessions "$SESSIONS" --seed "$SEED" --make-args "$MAKE_ARGS" \
+          -o "$WORK/$run.csc"
+        # Cooja resolves [CONFIG_DIR] against the simulation file, so the
+        # firmware is built next to the original .csc.
+        cp "$WORK/$run.csc" "$(dirname "$BASE")/.bench-$run.csc"
+        # Contiki's make does not rebuild objects when only CFLAGS change,
+        # and every point builds with its own PERIOD and MAKE_ARGS.
+        (cd "$(dirname "$BASE")" && make clean TARGET=sky > /dev/null)
+        (cd "$(dirname "$BASE")" &&
+          java -mx1024m -jar "$COOJA_JAR" -nogui=".bench-$run.csc" \
+            -contiki="$CONTIKI" > "$WORK/$run.log" 2>&1) || true
+        rm -f "$(dirname "$BASE")/.bench-$run.csc"
+        mv "$(dirname "$BASE")/COOJA.testlog" "$WORK/$run.testlog" 2>/dev/null || true
+        grep '^BENCH,' "$WORK/$run.testlog" 2>/dev/null |
+          sed "s/^BENCH,/$range,$rx,$nodes,$period,$SEED,/" >> "$OUT" || true
+        grep '^BENCH_ROOT,' "$WORK/$run.testlog" 2>/dev/null |
+          sed "s/^BENCH_ROOT,/$range,$rx,$nodes,$period,$SEED,/" >> "$OUT_ROOT" || true
+        grep '^BENCH_ALL,' "$WORK/$run.testlog" 2>/dev/null |
+          sed "s/^BENCH_ALL,/$range,$rx,$nodes,$period,$SEED,/" >> "$OUT_ALL" || true
+        if grep -q BENCH_TIMEOUT "$WORK/$run.testlog" 2>/dev/null; then
+          echo "   timed out before $SESSIONS sessions" >&2
+        fi
+      done
+    done
+  done
+done
+
+echo "results in $OUT, $OUT_ROOT and $OUT_ALL"
@@ -0,0 +1,39 @@
+/*
+ * Cooja test script for certificate dissemination (make CERT_TRICKLE=1).
+ *
+ * Waits until @NODES@ clients hold the provider certificate and logs one
+ * line per client from its "trickle: ... complete" line:
+ *
+ *   TRICKLE,<mote id>,<sim time ms>,<completion ms>,<summaries>,
+ *           <requests>,<fragments>
+ *
+ * then asks the provider (mote 1) for its counters and logs the time the
+ * last client completed and the transmissions of all nodes together:
+ *
+ *   TRICKLE_DONE,<sim time ms>,<transmissions>
+ */
+TIMEOUT(@TIMEOUT_MS@, log.log("TRICKLE_TIMEOUT," + done + "\n"); log.testFailed());
+
+var done = 0;
+var sent = 0;
+var last = 0;
+var re = /sent \[(\d+)\] summaries \[(\d+)\] requests \[(\d+)\] fragments/;
+
+while(done < @NODES@) {
+  YIELD();
+  var m = msg.match(/trickle: version \[\d+\] complete in \[(\d+)\] ms/);
+  if(m) {
+    var s = msg.match(re);
+    done++;
+    last = time;
+    sent += parseInt(s[1]) + parseInt(s[2]) + parseInt(s[3]);
+    log.log("TRICKLE," + id + "," + Math.round(time / 1000) + "," + m[1] + "," +
+            s[1] + "," + s[2] + "," + s[3] + "\n");
+  }
+}
+write(sim.getMoteWithID(1), "trickle");
+YIELD_THEN_WAIT_UNTIL(id == 1 && msg.startsWith("trickle: version"));
+var p = msg.match(re);
+sent += parseInt(p[1]) + parseInt(p[2]) + parseInt(p[3]);
+log.log("TRICKLE_DONE," + Math.round(last / 1000) + "," + sent + "\n");
+log.testOK();
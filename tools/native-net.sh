@@ -0,0 +1,67 @@
+#!/bin/sh
+#
+# Run one cert-service-provider and N cert-service-client processes
+# built with 'make TARGET=native' on the udp-radio loopback link.
+#
+#   tools/native-net.sh [clients] [seconds]
+#
+# UDP_RADIO_LOSS, UDP_RADIO_DELAY and UDP_RADIO_JITTER are passed to
+# every node. PERF=1 records the provider with 'perf record -g'.
+# PROVIDERS=<n> starts providers 1..n (build with PROVIDER_SELECT=1) and
+# the clients after them. Provider <id> takes host tools such as
+# cert-loadgen on 127.0.0.1 port 5687 + <id>.
+# Logs go to $LOG_DIR/node-<id>.log; completed flights are counted from
+# the clients' latency lines when the run ends.
+
+CLIENTS=${1:-4}
+SECONDS_TO_RUN=${2:-60}
+PROVIDERS=${PROVIDERS:-1}
+HERE=$(cd "$(dirname "$0")/.." && pwd)
+LOG_DIR=${LOG_DIR:-$HERE/native-logs}
+
+for f in cert-service-provider.native cert-service-client.native; do
+  if [ ! -x "$HERE/$f" ]; then
+    echo "$f missing, build with: make TARGET=native PERIOD=1" >&2
+    exit 1
+  fi
+done
+
+mkdir -p "$LOG_DIR"
+rm -f "$LOG_DIR"/node-*.log
+PIDS=
+
+start_node() {
+  # $1 node id, $2... command; each node keeps its files (CERT_STORE=1)
+  # in its own directory and, if a provider, its own front end port
+  id=$1
+  shift
+  mkdir -p "$LOG_DIR/node-$id"
+  (cd "$LOG_DIR/node-$id" &&
+   UDP_RADIO_NODE=$id HOST_FRONTEND_PORT=$((5687 + id)) \
+   exec stdbuf -oL "$@") > "$LOG_DIR/node-$id.log" 2>&1 &
+  PIDS="$PIDS $!"
+}
+
+if [ -n "$PERF" ]; then
+  start_node 1 perf record -g -o "$LOG_DIR/perf.data" "$HERE/cert-service-provider.native"
+else
+  start_node 1 "$HERE/cert-service-provider.native"
+fi
+i=2
+while [ $i -le $PROVIDERS ]; do
+  start_node $i "$HERE/cert-service-provider.native"
+  i=$((i + 1))
+done
+while [ $i -le $((CLIENTS + PROVIDERS)) ]; do
+  start_node $i "$HERE/cert-service-client.native"
+  i=$((i + 1))
+done
+
+trap 'kill $PIDS 2>/dev/null' INT TERM
+sleep "$SECONDS_TO_RUN"
+kill -INT $PIDS 2>/dev/null
+wait
+
+flights=$(cat "$LOG_DIR"/node-*.log | grep -c celasped_time)
+echo "$CLIENTS clients, $SECONDS_TO_RUN s: $flights flights," \
+     "$((flights * 60 / SECONDS_TO_RUN)) per minute"
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Build revocation filter updates for cert-revoke.c.
+
+Reads revoked certificate digests (64 hex digits per line, # comments)
+and prints serial commands:
+
+  default     "revoke <delta>" lines for the clients, each small enough
+              for the serial line buffer; send them in order
+  --provider  "revoke add <digest>" lines for the provider's exact list
+
+With --base the previous list (at --base-version) is diffed against the
+new one and only changed filter bytes are sent, otherwise the filter is
+rebuilt from empty. --bits and --hashes must match REVOKE_BITS and
+REVOKE_HASHES of the firmware.
+
+Usage: revoke-filter.py --version N [--base old.txt --base-version M]
+                        [--provider] digests.txt
+"""
+
+import argparse
+import math
+import sys
+
+# "revoke " plus hex in an 80 byte serial line: header and 10 entries.
+ENTRIES_PER_LINE = 10
+
+
+def read_digests(path):
+    digests = []
+    with open(path) as f:
+        for line in f:
+            line = line.split("#")[0].strip()
+            if not line:
+                continue
+            d = bytes.fromhex(line)
+            if len(d) != 32:
+                sys.exit("%s: not a SHA-256 digest: %s" % (path, line))
+            digests.append(d)
+    return digests
+
+
+def build(digests, bits, hashes):
+    """Same probes as cert_revoke_check()."""
+    f = bytearray(bits // 8)
+    for d in digests:
+        for i in range(hashes):
+            bit = ((d[2 * i] << 8) | d[2 * i + 1]) % bits
+            f[bit >> 3] |= 1 << (bit & 7)
+    return f
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("digests")
+    ap.add_argument("--version", type=int, required=True,
+                    help="new filter version, 1 to 65535")
+    ap.add_argument("--base", help="digest list the clients have now")
+    ap.add_argument("--base-version", type=int, default=0)
+    ap.add_argument("--bits", type=int, default=1024)
+    ap.add_argument("--hashes", type=int, default=4)
+    ap.add_argument("--provider", action="store_true")
+    args = ap.parse_args()
+
+    new = read_digests(args.digests)
+    old = read_digests(args.base) if args.base else []
+    if args.provider:
+        for d in new:
+            if d not in old:
+                print("revoke add " + d.hex())
+        return
+
+    f = build(new, args.bits, args.hashes)
+    if args.base:
+        prev, start = build(old, args.bits, args.hashes), args.base_version
+    else:
+        prev, start = bytearray(len(f)), 0
+    entries = [(i, f[i]) for i in range(len(f)) if f[i] != prev[i]]
+
+    n = len(new)
+    p = (1 - math.exp(-args.hashes * n / args.bits)) ** args.hashes
+    sys.stderr.write("%d digests, %d bits, k %d: %d bytes changed, "
+                     "false positives ~%.3f %%\n"
+                     % (n, args.bits, args.hashes, len(entries), p * 100))
+
+    frm = start
+    while True:
+        chunk, entries = entries[:ENTRIES_PER_LINE], entries[ENTRIES_PER_LINE:]
+        line = bytes([frm >> 8, frm & 0xff,
+                      args.version >> 8, args.version & 0xff])
+        for off, val in chunk:
+            line += bytes([off >> 8, off & 0xff, val])
+        print("revoke " + line.hex())
+        frm = args.version
+        if not entries:
+            break
+
+
+if __name__ == "__main__":
+    main()
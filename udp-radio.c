@@ -0,0 +1,357 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Loopback radio for TARGET=native, see udp-radio.h.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+#include "net/linkaddr.h"
+#include "net/ipv6/uip-ds6.h"
+#include "lib/random.h"
+#include "udp-radio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* On the wire every frame is prefixed with the sender's node id, so a
+   process can drop its own frames looped back by the group. */
+#define HDR_LEN 2
+
+struct frame {
+  clock_time_t due;
+  uint16_t len;
+  uint8_t data[UDP_RADIO_MAX_FRAME];
+};
+
+static struct frame queue[UDP_RADIO_QUEUE];
+static uint8_t queue_head, queue_count;
+
+static uint8_t tx_buf[HDR_LEN + UDP_RADIO_MAX_FRAME];
+static uint16_t tx_len;
+
+static int sock = -1;
+static struct sockaddr_in group;
+static uint8_t radio_is_on;
+static uint16_t node_id;
+static unsigned loss = UDP_RADIO_LOSS;
+static unsigned delay = UDP_RADIO_DELAY;
+static unsigned jitter;
+
+PROCESS(udp_radio_process, "UDP radio");
+/*---------------------------------------------------------------------------*/
+static unsigned
+env_or(const char *name, unsigned def)
+{
+  const char *v = getenv(name);
+  return v != NULL ? (unsigned)atoi(v) : def;
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(sock, rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fd(fd_set *rset, fd_set *wset)
+{
+  uint8_t buf[HDR_LEN + UDP_RADIO_MAX_FRAME];
+  struct frame *f;
+  clock_time_t due;
+  ssize_t n;
+
+  if(!FD_ISSET(sock, rset)) {
+    return;
+  }
+  n = recv(sock, buf, sizeof(buf), 0);
+  if(n <= HDR_LEN || ((buf[0] << 8) | buf[1]) == node_id || !radio_is_on) {
+    return;
+  }
+  if(loss > 0 && random_rand() % 100 < loss) {
+    return;
+  }
+  if(queue_count == UDP_RADIO_QUEUE) {
+    return;
+  }
+
+  due = clock_time() + (delay * CLOCK_SECOND) / 1000;
+  if(jitter > 0) {
+    due += ((random_rand() % (jitter + 1)) * CLOCK_SECOND) / 1000;
+  }
+  /* Keep the queue in delivery order; jitter never reorders frames. */
+  if(queue_count > 0) {
+    f = &queue[(queue_head + queue_count - 1) % UDP_RADIO_QUEUE];
+    if(CLOCK_LT(due, f->due)) {
+      due = f->due;
+    }
+  }
+  f = &queue[(queue_head + queue_count) % UDP_RADIO_QUEUE];
+  f->due = due;
+  f->len = n - HDR_LEN;
+  memcpy(f->data, buf + HDR_LEN, f->len);
+  queue_count++;
+  process_poll(&udp_radio_process);
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback udp_radio_callback = { set_fd, handle_fd };
+/*---------------------------------------------------------------------------*/
+static int
+pending_packet(void)
+{
+  return queue_count > 0 &&
+    !CLOCK_LT(clock_time(), queue[queue_head].due);
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_packet(void *buf, unsigned short buf_len)
+{
+  struct frame *f;
+  int len;
+
+  if(!pending_packet()) {
+    return 0;
+  }
+  f = &queue[queue_head];
+  len = f->len < buf_len ? f->len : buf_len;
+  memcpy(buf, f->data, len);
+  queue_head = (queue_head + 1) % UDP_RADIO_QUEUE;
+  queue_count--;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+prepare(const void *payload, unsigned short payload_len)
+{
+  if(payload_len > UDP_RADIO_MAX_FRAME) {
+    return 1;
+  }
+  memcpy(tx_buf + HDR_LEN, payload, payload_len);
+  tx_len = payload_len;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+transmit(unsigned short transmit_len)
+{
+  if(sendto(sock, tx_buf, HDR_LEN + tx_len, 0,
+            (struct sockaddr *)&group, sizeof(group)) < 0) {
+    return RADIO_TX_ERR;
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+send_packet(const void *payload, unsigned short payload_len)
+{
+  if(prepare(payload, payload_len)) {
+    return RADIO_TX_ERR;
+  }
+  return transmit(payload_len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+channel_clear(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+receiving_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  radio_is_on = 1;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(void)
+{
+  radio_is_on = 0;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_value(radio_param_t param, radio_value_t *value)
+{
+  if(param == RADIO_PARAM_POWER_MODE) {
+    *value = radio_is_on ? RADIO_POWER_MODE_ON : RADIO_POWER_MODE_OFF;
+    return RADIO_RESULT_OK;
+  }
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static int
+init(void)
+{
+  struct ip_mreq mreq;
+  struct in_addr lo;
+  unsigned char ttl = 0, loop = 1;
+  int one = 1;
+
+  node_id = env_or("UDP_RADIO_NODE", getpid() & 0xffff);
+  /* Every frame carries the sender so receivers can drop their own. */
+  tx_buf[0] = node_id >> 8;
+  tx_buf[1] = node_id & 0xff;
+  loss = env_or("UDP_RADIO_LOSS", UDP_RADIO_LOSS);
+  delay = env_or("UDP_RADIO_DELAY", UDP_RADIO_DELAY);
+  jitter = env_or("UDP_RADIO_JITTER", 0);
+
+  sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if(sock < 0) {
+    perror("udp-radio: socket");
+    exit(1);
+  }
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  memset(&group, 0, sizeof(group));
+  group.sin_family = AF_INET;
+  group.sin_port = htons(UDP_RADIO_PORT);
+  group.sin_addr.s_addr = htonl(INADDR_ANY);
+  if(bind(sock, (struct sockaddr *)&group, sizeof(group)) < 0) {
+    perror("udp-radio: bind");
+    exit(1);
+  }
+  group.sin_addr.s_addr = inet_addr(UDP_RADIO_GROUP);
+
+  lo.s_addr = htonl(INADDR_LOOPBACK);
+  mreq.imr_multiaddr = group.sin_addr;
+  mreq.imr_interface = lo;
+  if(setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+    perror("udp-radio: join " UDP_RADIO_GROUP);
+    exit(1);
+  }
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &lo, sizeof(lo));
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+  select_set_callback(sock, &udp_radio_callback);
+  process_start(&udp_radio_process, NULL);
+
+  printf("udp-radio: node %u on %s:%u, loss %u%%, delay %u+%u ms\n",
+         node_id, UDP_RADIO_GROUP, UDP_RADIO_PORT, loss, delay, jitter);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* The native platform gives every process the same fixed link address.
+   This runs after tcpip_process has started, so the link-local address
+   derived from the old one is replaced as well. */
+static void
+set_node_addr(void)
+{
+  uip_ds6_addr_t *lladdr;
+  uip_ipaddr_t ipaddr;
+
+  linkaddr_node_addr.u8[LINKADDR_SIZE - 2] = node_id >> 8;
+  linkaddr_node_addr.u8[LINKADDR_SIZE - 1] = node_id & 0xff;
+  memcpy(&uip_lladdr.addr, &linkaddr_node_addr, sizeof(uip_lladdr.addr));
+
+  lladdr = uip_ds6_get_link_local(-1);
+  if(lladdr != NULL) {
+    uip_ds6_addr_rm(lladdr);
+  }
+  uip_create_linklocal_prefix(&ipaddr);
+  uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
+  uip_ds6_addr_add(&ipaddr, 0, ADDR_AUTOCONF);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(udp_radio_process, ev, data)
+{
+  static struct etimer et;
+  int len;
+
+  PROCESS_BEGIN();
+
+  PROCESS_PAUSE();
+  set_node_addr();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL || ev == PROCESS_EVENT_TIMER);
+
+    while(pending_packet()) {
+      packetbuf_clear();
+      len = read_packet(packetbuf_dataptr(), PACKETBUF_SIZE);
+      packetbuf_set_datalen(len);
+      NETSTACK_RDC.input();
+    }
+    if(queue_count > 0) {
+      etimer_set(&et, queue[queue_head].due - clock_time());
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver udp_radio_driver = {
+  init,
+  prepare,
+  transmit,
+  send_packet,
+  read_packet,
+  channel_clear,
+  receiving_packet,
+  pending_packet,
+  on,
+  off,
+  get_value,
+  set_value,
+  get_object,
+  set_object
+};
+/*---------------------------------------------------------------------------*/
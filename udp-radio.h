@@ -0,0 +1,83 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Loopback radio for TARGET=native. Every process on the host
+ *         joins one UDP multicast group on 127.0.0.1, so a provider and
+ *         any number of clients share a single broadcast link.
+ *
+ *         Loss and delay are injected at the receiver. The compile-time
+ *         defaults can be overridden per process from the environment:
+ *
+ *         UDP_RADIO_NODE    node id, also the last two link address bytes
+ *         UDP_RADIO_LOSS    frame loss in percent
+ *         UDP_RADIO_DELAY   link delay in milliseconds
+ *         UDP_RADIO_JITTER  extra random delay, 0..n milliseconds
+ */
+
+#ifndef UDP_RADIO_H_
+#define UDP_RADIO_H_
+
+#include "dev/radio.h"
+
+#ifdef UDP_RADIO_CONF_GROUP
+#define UDP_RADIO_GROUP UDP_RADIO_CONF_GROUP
+#else
+#define UDP_RADIO_GROUP "239.255.42.99"
+#endif
+
+#ifdef UDP_RADIO_CONF_PORT
+#define UDP_RADIO_PORT UDP_RADIO_CONF_PORT
+#else
+#define UDP_RADIO_PORT 30001
+#endif
+
+#ifdef UDP_RADIO_CONF_LOSS
+#define UDP_RADIO_LOSS UDP_RADIO_CONF_LOSS
+#else
+#define UDP_RADIO_LOSS 0
+#endif
+
+#ifdef UDP_RADIO_CONF_DELAY
+#define UDP_RADIO_DELAY UDP_RADIO_CONF_DELAY
+#else
+#define UDP_RADIO_DELAY 0
+#endif
+
+/* Received frames waiting for their delivery time. */
+#ifdef UDP_RADIO_CONF_QUEUE
+#define UDP_RADIO_QUEUE UDP_RADIO_CONF_QUEUE
+#else
+#define UDP_RADIO_QUEUE 16
+#endif
+
+#define UDP_RADIO_MAX_FRAME 127
+
+extern const struct radio_driver udp_radio_driver;
+
+#endif /* UDP_RADIO_H_ */